@@ -7,22 +7,44 @@
 #include <stdbool.h>
 #include <stdint.h>
 #include <ctype.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <inttypes.h>
+#include <poll.h>
+#include <signal.h>
 #include <string.h>
+#include <threads.h>
+#include <time.h>
 #include <unistd.h>   // isatty, fileno
 
 enum {
-    MODULUS       = 100,
-    LINE_BUF_SIZE = 128
+    DEFAULT_MODULUS = 100,
+    START_POS       = 50,      // dial position before the first rotation
+    MAX_MODULUS     = 1 << 16, // RotIndex keeps positions in 16 bits
+    READ_CHUNK      = 1 << 20, // bytes per fread in the batch path
+    BATCH_LEN       = 1 << 14, // rotations per rotate_batch call
+    SCAN_BLOCK      = 16,      // lanes per block of the prefix scan
+    THREAD_CHUNK    = 8 << 20, // bytes per worker per round in --threads
+    MAX_THREADS     = 256,
+    STREAM_READ     = 64 << 10, // bytes per read() in --stream
+    LAT_BUCKETS     = 64        // log2(ns) latency histogram
 };
 
-static int
-mod_int(int value, int m)
+typedef void (*DialKernel)(const int32_t *delta, int k, uint32_t m,
+                           uint32_t *pos, long long *part1, long long *part2);
+
+// Dial size (--modulus) and the rotate_block kernel chosen for it.  Set once
+// in main before any work starts.
+static struct {
+    uint32_t   m;
+    DialKernel block;
+} dial;
+
+// value mod dial.m for value >= -dial.m.
+static inline int
+mod_int(int value)
 {
-    int r = value % m;
-    if (r < 0) {
-        r += m;
-    }
-    return r;
+    return (int)(((uint32_t)value + dial.m) % dial.m);
 }
 
 static void
@@ -44,65 +66,78 @@ trim_whitespace(char *s)
     *q = '\0';
 }
 
-static void
-process_line(const char *line, int *pos, long long *part1, long long *part2)
+// Validates a trimmed, non-empty rotation line.  Returns NULL on success,
+// otherwise the message process_line reports for it.
+static const char *
+parse_line(const char *line, char *dir, long long *dist)
 {
-    if (line == NULL || *line == '\0') {
-        return;
-    }
-
-    char dir = line[0];
-    if (dir != 'L' && dir != 'R') {
-        fprintf(stderr, "Invalid direction in line: %s\n", line);
-        exit(EXIT_FAILURE);
+    *dir = line[0];
+    if (*dir != 'L' && *dir != 'R') {
+        return "Invalid direction";
     }
 
     const char *p = line + 1;
     if (*p == '\0') {
-        fprintf(stderr, "Missing distance in line: %s\n", line);
-        exit(EXIT_FAILURE);
+        return "Missing distance";
     }
 
     char *endptr = NULL;
-    long long dist_full = strtoll(p, &endptr, 10);
-    if (endptr == p || dist_full < 0) {
-        fprintf(stderr, "Invalid distance in line: %s\n", line);
+    *dist = strtoll(p, &endptr, 10);
+    if (endptr == p || *dist < 0) {
+        return "Invalid distance";
+    }
+    return NULL;
+}
+
+static void
+process_line(const char *line, int *pos, long long *part1, long long *part2)
+{
+    if (line == NULL || *line == '\0') {
+        return;
+    }
+
+    char        dir;
+    long long   dist_full;
+    const char *err = parse_line(line, &dir, &dist_full);
+    if (err != NULL) {
+        fprintf(stderr, "%s in line: %s\n", err, line);
         exit(EXIT_FAILURE);
     }
 
     // Part 2: count hits of 0 during this rotation
     long long hits = 0;
-    int s = mod_int(*pos, MODULUS); // normalize starting position
+    const long long M = dial.m;
+    int s = mod_int(*pos); // normalize starting position
     long long d = dist_full;
 
     if (d > 0) {
         long long t0;
 
         if (dir == 'R') {
-            t0 = (MODULUS - s) % MODULUS; 
+            t0 = (M - s) % M; 
             if (t0 == 0) {
-                t0 = MODULUS;
+                t0 = M;
             }
         } else {
-            t0 = s % MODULUS;
+            t0 = s % M;
             if (t0 == 0) {
-                t0 = MODULUS;
+                t0 = M;
             }
         }
 
         if (t0 <= d) {
-            hits = 1 + ( (d - t0) / MODULUS );
+            hits = 1 + ( (d - t0) / M );
         }
     }
 
     *part2 += hits;
 
     // Part 1 + position update:
-    int step = (int)(dist_full % MODULUS);
+    int step = (int)(dist_full % M);
     if (dir == 'L') {
-        *pos = mod_int(*pos - step, MODULUS);
+        *pos = mod_int(*pos - step);
     } else {
-        *pos = mod_int(*pos + step, MODULUS);
+        *pos = mod_int(*pos + step);
     }
 
     if (*pos == 0) {
@@ -110,6 +145,468 @@ process_line(const char *line, int *pos, long long *part1, long long *part2)
     }
 }
 
+// Batch kernel for up to SCAN_BLOCK rotations on a dial of M positions.
+// delta[] holds signed distances (R positive, L negative) with
+// |delta| < 2^31.
+//
+// Every lane's right-step and end position depend only on the block's start
+// position and an inclusive prefix sum of steps, so the divisions all run
+// lane-parallel.  A rotation of |d| = q * M + r hits 0 q times, plus once
+// more if the remainder reaches 0: measured in the rotation's own direction
+// the start is s (R) or (M - s) % M (L), and the extra hit is from + r >= M.
+//
+// DIAL_KERNEL instantiates the kernel for one dial size.  DIV(n) and MOD(n)
+// must give n / M and n % M for every n < 2^31; the constant sizes use a
+// multiply-shift or a mask so no lane performs a real division, and any
+// other power of two uses a shift and mask derived from m.
+#define DIAL_KERNEL(name, M, DIV, MOD)                                      \
+    static void                                                             \
+    rotate_block_##name(const int32_t *delta, int k, uint32_t m,            \
+                        uint32_t *pos, long long *part1, long long *part2)  \
+    {                                                                       \
+        uint32_t left[SCAN_BLOCK];                                          \
+        uint32_t quot[SCAN_BLOCK];                                          \
+        uint32_t rem[SCAN_BLOCK];                                           \
+        uint32_t step[SCAN_BLOCK];                                          \
+        uint32_t pre[SCAN_BLOCK];                                           \
+                                                                            \
+        (void)m;                                                            \
+        for (int j = 0; j < k; j++) {                                       \
+            uint32_t neg = (uint32_t)(delta[j] >> 31); /* ones for L */     \
+            uint32_t mag = ((uint32_t)delta[j] ^ neg) - neg;                \
+                                                                            \
+            left[j] = neg;                                                  \
+            quot[j] = DIV(mag);                                             \
+            rem[j]  = mag - quot[j] * (M);                                  \
+            step[j] = (((M) - rem[j]) & neg) | (rem[j] & ~neg);             \
+        }                                                                   \
+                                                                            \
+        uint32_t run = 0;                                                   \
+        for (int j = 0; j < k; j++) {                                       \
+            run += step[j];                                                 \
+            pre[j] = run;                                                   \
+        }                                                                   \
+                                                                            \
+        uint32_t zeros = 0;                                                 \
+        uint64_t hits  = 0;                                                 \
+        for (int j = 0; j < k; j++) {                                       \
+            uint32_t end   = MOD(*pos + pre[j]);                            \
+            uint32_t start = MOD(*pos + pre[j] - step[j]);                  \
+            uint32_t from  = (MOD((M) - start) & left[j]) |                 \
+                             (start & ~left[j]);                            \
+                                                                            \
+            zeros += (end == 0U);                                           \
+            hits  += (uint64_t)quot[j] + (from + rem[j] >= (M));            \
+        }                                                                   \
+                                                                            \
+        *pos = MOD(*pos + run);                                             \
+        *part1 += zeros;                                                    \
+        *part2 += (long long)hits;                                          \
+    }
+
+// Magic numbers are ceil(2^s / M) for the smallest s that keeps the
+// rounding error below one unit over n < 2^31; checked exhaustively.
+#define DIV_60(n)  ((uint32_t)(((uint64_t)(n) * 0x88888889U) >> 37))
+#define MOD_60(n)  ((n) - DIV_60(n) * 60U)
+#define DIV_100(n) ((uint32_t)(((uint64_t)(n) * 0x51EB851FU) >> 37))
+#define MOD_100(n) ((n) - DIV_100(n) * 100U)
+#define DIV_256(n) ((uint32_t)(n) >> 8)
+#define MOD_256(n) ((uint32_t)(n) & 255U)
+#define DIV_360(n) ((uint32_t)(((uint64_t)(n) * 0xB60B60B7U) >> 40))
+#define MOD_360(n) ((n) - DIV_360(n) * 360U)
+#define DIV_POW2(n) ((uint32_t)(n) >> __builtin_ctz(m))
+#define MOD_POW2(n) ((uint32_t)(n) & (m - 1U))
+#define DIV_ANY(n) ((uint32_t)(n) / m)
+#define MOD_ANY(n) ((uint32_t)(n) % m)
+
+DIAL_KERNEL(60, 60U, DIV_60, MOD_60)
+DIAL_KERNEL(100, 100U, DIV_100, MOD_100)
+DIAL_KERNEL(256, 256U, DIV_256, MOD_256)
+DIAL_KERNEL(360, 360U, DIV_360, MOD_360)
+DIAL_KERNEL(pow2, m, DIV_POW2, MOD_POW2)
+DIAL_KERNEL(any, m, DIV_ANY, MOD_ANY)
+
+static const struct {
+    uint32_t   m;
+    DialKernel block;
+} dial_kernels[] = {
+    { 60, rotate_block_60 },
+    { 100, rotate_block_100 },
+    { 256, rotate_block_256 },
+    { 360, rotate_block_360 },
+};
+
+static void
+dial_select(uint32_t m)
+{
+    dial.m     = m;
+    dial.block = ((m & (m - 1U)) == 0U) ? rotate_block_pow2
+                                        : rotate_block_any;
+    for (size_t i = 0U; i < sizeof dial_kernels / sizeof dial_kernels[0];
+         i++) {
+        if (dial_kernels[i].m == m) {
+            dial.block = dial_kernels[i].block;
+        }
+    }
+}
+
+static void
+rotate_batch(const int32_t *delta, size_t n, int *pos, long long *part1,
+             long long *part2)
+{
+    uint32_t p = (uint32_t)mod_int(*pos);
+
+    for (size_t i = 0U; i < n; i += SCAN_BLOCK) {
+        int k = (n - i < SCAN_BLOCK) ? (int)(n - i) : SCAN_BLOCK;
+        dial.block(delta + i, k, dial.m, &p, part1, part2);
+    }
+    *pos = (int)p;
+}
+
+// Parses "<L|R><digits>" with optional surrounding whitespace into a signed
+// delta.  Returns false for anything else (inner whitespace, signs, trailing
+// junk, distances >= 2^31), which the caller hands to process_line so the
+// accepted syntax and error messages stay exactly those of the scalar path.
+static bool
+parse_rotation(const char *s, const char *e, int32_t *delta)
+{
+    while (s < e && isspace((unsigned char)*s)) {
+        s++;
+    }
+    if (s == e || (*s != 'L' && *s != 'R')) {
+        return false;
+    }
+
+    bool left = (*s++ == 'L');
+    const char *digits = s;
+    uint64_t v = 0;
+
+    while (s < e && *s >= '0' && *s <= '9' && s - digits < 10) {
+        v = v * 10U + (uint64_t)(*s - '0');
+        s++;
+    }
+    if (s == digits || v > INT32_MAX) {
+        return false;
+    }
+    while (s < e && isspace((unsigned char)*s)) {
+        s++;
+    }
+    if (s != e) {
+        return false;
+    }
+
+    *delta = left ? -(int32_t)v : (int32_t)v;
+    return true;
+}
+
+// Scalar fallback for one line the batch parser declined.
+static void
+process_raw_line(const char *s, const char *e, int *pos, long long *part1,
+                 long long *part2)
+{
+    size_t len = (size_t)(e - s);
+    char  *buf = malloc(len + 1U);
+
+    if (buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    memcpy(buf, s, len);
+    buf[len] = '\0';
+
+    trim_whitespace(buf);
+    process_line(buf, pos, part1, part2);
+    free(buf);
+}
+
+// Reads fp in READ_CHUNK blocks, parses whole lines into deltas and runs
+// them through rotate_batch BATCH_LEN at a time.
+static bool
+run_batched(FILE *fp, int *pos, long long *part1, long long *part2)
+{
+    static int32_t delta[BATCH_LEN];
+    size_t nd   = 0U;
+    size_t cap  = READ_CHUNK;
+    size_t have = 0U;
+    char  *buf  = malloc(cap);
+
+    if (buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (;;) {
+        if (have == cap) {
+            // one line longer than the buffer
+            cap *= 2U;
+            char *nb = realloc(buf, cap);
+            if (nb == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            buf = nb;
+        }
+
+        size_t got = fread(buf + have, 1U, cap - have, fp);
+        bool   eof = (got == 0U);
+        have += got;
+
+        const char *p   = buf;
+        const char *end = buf + have;
+        for (;;) {
+            const char *nl = memchr(p, '\n', (size_t)(end - p));
+            if (nl == NULL) {
+                if (!eof || p == end) {
+                    break;
+                }
+                nl = end; // final line without a newline
+            }
+
+            int32_t d;
+            if (parse_rotation(p, nl, &d)) {
+                delta[nd++] = d;
+                if (nd == BATCH_LEN) {
+                    rotate_batch(delta, nd, pos, part1, part2);
+                    nd = 0U;
+                }
+            } else {
+                rotate_batch(delta, nd, pos, part1, part2);
+                nd = 0U;
+                process_raw_line(p, nl, pos, part1, part2);
+            }
+            p = (nl < end) ? nl + 1 : nl;
+        }
+
+        have = (size_t)(end - p);
+        memmove(buf, p, have);
+        if (eof) {
+            break;
+        }
+    }
+
+    rotate_batch(delta, nd, pos, part1, part2);
+    free(buf);
+    return !ferror(fp);
+}
+
+// Summary of a run of rotations as a function of the dial position it
+// starts from.  Offsets are relative to that start, so one pass over the
+// chunk fills the table for all dial.m starting positions: the rotation
+// ending at offset k lands on 0 iff start == -k, and a rotation's remainder
+// adds a hit for a contiguous (cyclic) range of starts, recorded in a
+// difference array.
+typedef struct {
+    const char *s; // whole lines [s, e)
+    const char *e;
+    uint32_t    net;   // total right-steps mod dial.m
+    long long  *zero;  // [dial.m] Part 1 hits for each start
+    long long  *cross; // [dial.m] Part 2 hits for each start
+    const char *bad;            // first line process_line would reject
+    const char *bad_end;
+} ChunkSum;
+
+// Adds 1 to diff[] over the cyclic range [lo, lo + len) mod m, len < m.
+static void
+add_cyclic(long long *diff, uint32_t m, uint32_t lo, uint32_t len)
+{
+    diff[lo]++;
+    if (lo + len <= m) {
+        diff[lo + len]--;
+    } else {
+        diff[m]--;
+        diff[0]++;
+        diff[lo + len - m]--;
+    }
+}
+
+static int
+summarise_chunk(void *arg)
+{
+    ChunkSum *c = arg;
+    uint32_t  M     = dial.m;
+    long long *ends = calloc(M, sizeof *ends);
+    long long *diff = calloc(M + 1U, sizeof *diff);
+    long long turns = 0;
+    uint32_t  off   = 0;
+
+    if (ends == NULL || diff == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    for (const char *p = c->s; p < c->e;) {
+        const char *nl = memchr(p, '\n', (size_t)(c->e - p));
+        if (nl == NULL) {
+            nl = c->e;
+        }
+
+        bool      left;
+        long long mag;
+        int32_t   d;
+        if (parse_rotation(p, nl, &d)) {
+            left = (d < 0);
+            mag  = left ? -(long long)d : d;
+        } else {
+            size_t len = (size_t)(nl - p);
+            char  *buf = malloc(len + 1U);
+            char   dir;
+
+            if (buf == NULL) {
+                fprintf(stderr, "Out of memory\n");
+                exit(EXIT_FAILURE);
+            }
+            memcpy(buf, p, len);
+            buf[len] = '\0';
+            trim_whitespace(buf);
+
+            bool blank = (buf[0] == '\0');
+            bool bad   = !blank && parse_line(buf, &dir, &mag) != NULL;
+            free(buf);
+            if (bad) {
+                c->bad     = p;
+                c->bad_end = nl;
+                break;
+            }
+            if (blank) {
+                p = (nl < c->e) ? nl + 1 : nl;
+                continue;
+            }
+            left = (dir == 'L');
+        }
+
+        // The rotation starts at (start + off) % M; its remainder r
+        // reaches 0 from s in [M - r, M) going right and from s in [1, r]
+        // going left.
+        uint32_t r = (uint32_t)(mag % M);
+        turns += mag / M;
+        if (r != 0U) {
+            uint32_t lo = left ? 1U : M - r;
+            add_cyclic(diff, M, (lo + M - off) % M, r);
+            off = left ? (off + M - r) % M : (off + r) % M;
+        }
+        ends[off]++;
+
+        p = (nl < c->e) ? nl + 1 : nl;
+    }
+
+    long long run = 0;
+    for (uint32_t start = 0; start < M; start++) {
+        run += diff[start];
+        c->zero[start]  = ends[(M - start) % M];
+        c->cross[start] = turns + run;
+    }
+    c->net = off;
+    free(ends);
+    free(diff);
+    return 0;
+}
+
+// Reads fp in rounds of nthreads * THREAD_CHUNK bytes, splits each round at
+// line boundaries, summarises the pieces in parallel and folds the
+// summaries into the dial state in input order.
+static bool
+run_threaded(FILE *fp, int nthreads, int *pos, long long *part1,
+             long long *part2)
+{
+    ChunkSum *sum = calloc((size_t)nthreads, sizeof *sum);
+    thrd_t   *tid = calloc((size_t)nthreads, sizeof *tid);
+    long long *tab = calloc(2U * (size_t)nthreads * dial.m, sizeof *tab);
+    size_t    cap  = (size_t)nthreads * THREAD_CHUNK;
+    size_t    have = 0U;
+    char     *buf  = malloc(cap);
+    bool      eof  = false;
+
+    if (sum == NULL || tid == NULL || tab == NULL || buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (!eof || have > 0U) {
+        while (!eof && have < cap) {
+            size_t got = fread(buf + have, 1U, cap - have, fp);
+            have += got;
+            eof = (got == 0U);
+        }
+
+        // Whole lines only, unless this is the tail of the input.
+        size_t whole = have;
+        if (!eof) {
+            while (whole > 0U && buf[whole - 1U] != '\n') {
+                whole--;
+            }
+            if (whole == 0U) {
+                // one line longer than the buffer
+                cap *= 2U;
+                char *nb = realloc(buf, cap);
+                if (nb == NULL) {
+                    fprintf(stderr, "Out of memory\n");
+                    exit(EXIT_FAILURE);
+                }
+                buf = nb;
+                continue;
+            }
+        }
+
+        const char *p = buf;
+        for (int t = 0; t < nthreads; t++) {
+            const char *e = buf + whole;
+            if (t < nthreads - 1) {
+                const char *cut = buf + whole * (size_t)(t + 1) /
+                                  (size_t)nthreads;
+                if (cut <= p) {
+                    e = p;
+                } else {
+                    const char *nl = memchr(cut - 1, '\n',
+                                            (size_t)(e - cut + 1));
+                    if (nl != NULL) {
+                        e = nl + 1;
+                    }
+                }
+            }
+            sum[t] = (ChunkSum){
+                .s     = p,
+                .e     = e,
+                .zero  = tab + (2U * (size_t)t) * dial.m,
+                .cross = tab + (2U * (size_t)t + 1U) * dial.m,
+            };
+            p = e;
+        }
+
+        for (int t = 1; t < nthreads; t++) {
+            if (thrd_create(&tid[t], summarise_chunk, &sum[t]) !=
+                thrd_success) {
+                fprintf(stderr, "thrd_create failed\n");
+                exit(EXIT_FAILURE);
+            }
+        }
+        summarise_chunk(&sum[0]);
+        for (int t = 1; t < nthreads; t++) {
+            thrd_join(tid[t], NULL);
+        }
+
+        for (int t = 0; t < nthreads; t++) {
+            if (sum[t].bad != NULL) {
+                // reports the error exactly as the scalar path would
+                process_raw_line(sum[t].bad, sum[t].bad_end, pos, part1,
+                                 part2);
+            }
+            int start = mod_int(*pos);
+            *part1 += sum[t].zero[start];
+            *part2 += sum[t].cross[start];
+            *pos    = (int)(((uint32_t)start + sum[t].net) % dial.m);
+        }
+
+        have -= whole;
+        memmove(buf, buf + whole, have);
+    }
+
+    free(buf);
+    free(tab);
+    free(tid);
+    free(sum);
+    return !ferror(fp);
+}
+
 // Embedded sample data a la Perl's __DATA__ equivalent
 static const char *sample_data[] = {
     "L68",
@@ -126,12 +623,494 @@ static const char *sample_data[] = {
 static const size_t sample_count =
     sizeof sample_data / sizeof sample_data[0];
 
+// --stream: event-at-a-time mode for a pipe or FIFO that stays open.
+//
+// stdin is switched to O_NONBLOCK and drained with read() whenever poll()
+// reports data, so every complete line in a burst is applied before the next
+// wakeup.  A snapshot line goes to stdout after every `every` events and/or
+// every `interval_ms` milliseconds.  An event's latency runs from the read()
+// that delivered its last byte to the point its update (and snapshot, if one
+// is due) is done; the log2 histogram of those latencies is written as
+// bench-style JSON to stats_path at EOF.  Their mean is mean_latency_ns:
+// sec also counts the idle waits, so bench_aoc's ns_per_item would not fit.
+typedef struct {
+    long     every;
+    long     interval_ms;
+    uint64_t hist[LAT_BUCKETS];
+    uint64_t events;
+    uint64_t sum_ns;
+    uint64_t max_ns;
+} StreamStats;
+
+static uint64_t
+now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000U + (uint64_t)ts.tv_nsec;
+}
+
+static void
+snapshot(uint64_t events, int pos, long long part1, long long part2)
+{
+    printf("events=%" PRIu64 " pos=%d part1=%lld part2=%lld\n", events, pos,
+           part1, part2);
+    fflush(stdout);
+}
+
+static void
+record_latency(StreamStats *st, uint64_t ns)
+{
+    int b = (ns == 0U) ? 0 : 64 - __builtin_clzll(ns);
+    st->hist[b < LAT_BUCKETS ? b : LAT_BUCKETS - 1]++;
+    st->sum_ns += ns;
+    if (ns > st->max_ns) {
+        st->max_ns = ns;
+    }
+}
+
+// Upper bound (ns) of the bucket holding quantile q, capped at the maximum.
+static uint64_t
+latency_quantile(const StreamStats *st, double q)
+{
+    uint64_t want = (uint64_t)(q * (double)st->events);
+    uint64_t seen = 0;
+
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        seen += st->hist[b];
+        if (seen > want) {
+            uint64_t hi = (b == 0) ? 0U : (UINT64_C(1) << b) - 1U;
+            return (hi < st->max_ns) ? hi : st->max_ns;
+        }
+    }
+    return st->max_ns;
+}
+
+static void
+write_stream_stats(const char *path, const StreamStats *st, double sec,
+                   long long part2)
+{
+    FILE *fp = (strcmp(path, "-") == 0) ? stderr : fopen(path, "w");
+    if (fp == NULL) {
+        perror(path);
+        return;
+    }
+
+    uint64_t n = (st->events > 0U) ? st->events : 1U;
+    fprintf(fp, "{\n  \"suite\": \"day01\",\n  \"results\": [\n");
+    fprintf(fp, "    {\"name\": \"stream event latency\", "
+                "\"pattern\": \"every=%ld interval_ms=%ld\", "
+                "\"n\": %" PRIu64 ", \"reps\": 1, \"sec\": %.6f, "
+                "\"mean_latency_ns\": %.3f, \"check\": \"%016llx\",\n",
+            st->every, st->interval_ms, st->events, sec,
+            (double)st->sum_ns / (double)n, (unsigned long long)part2);
+    fprintf(fp, "     \"p50_ns\": %" PRIu64 ", \"p90_ns\": %" PRIu64
+                ", \"p99_ns\": %" PRIu64 ", \"p999_ns\": %" PRIu64
+                ", \"max_ns\": %" PRIu64 ",\n",
+            latency_quantile(st, 0.50), latency_quantile(st, 0.90),
+            latency_quantile(st, 0.99), latency_quantile(st, 0.999),
+            st->max_ns);
+    fprintf(fp, "     \"hist_log2_ns\": [");
+    for (int b = 0; b < LAT_BUCKETS; b++) {
+        fprintf(fp, "%s%" PRIu64, (b > 0) ? ", " : "", st->hist[b]);
+    }
+    fprintf(fp, "]}\n  ]\n}\n");
+
+    if (fp != stderr) {
+        fclose(fp);
+    }
+}
+
+// Applies one raw line; returns false for blank lines.
+static bool
+stream_event(const char *s, const char *e, int *pos, long long *part1,
+             long long *part2)
+{
+    int32_t d;
+
+    if (parse_rotation(s, e, &d)) {
+        rotate_batch(&d, 1U, pos, part1, part2);
+        return true;
+    }
+    for (const char *p = s; p < e; p++) {
+        if (!isspace((unsigned char)*p)) {
+            process_raw_line(s, e, pos, part1, part2);
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool
+stream_loop(int fd, StreamStats *st, int *pos, long long *part1,
+            long long *part2)
+{
+    size_t   cap  = STREAM_READ * 2;
+    size_t   have = 0U;
+    char    *buf  = malloc(cap);
+    bool     eof  = false;
+    uint64_t next_tick = (st->interval_ms > 0)
+                       ? now_ns() + (uint64_t)st->interval_ms * 1000000U
+                       : 0U;
+
+    if (buf == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+
+    while (!eof) {
+        int timeout = -1;
+        if (st->interval_ms > 0) {
+            uint64_t t = now_ns();
+            timeout = (t >= next_tick)
+                    ? 0 : (int)((next_tick - t + 999999U) / 1000000U);
+        }
+
+        struct pollfd pfd = { .fd = fd, .events = POLLIN };
+        int rc = poll(&pfd, 1, timeout);
+        if (rc < 0 && errno != EINTR) {
+            perror("poll");
+            free(buf);
+            return false;
+        }
+
+        while (rc > 0) {
+            if (cap - have < STREAM_READ) {
+                cap *= 2U;
+                char *nb = realloc(buf, cap);
+                if (nb == NULL) {
+                    fprintf(stderr, "Out of memory\n");
+                    exit(EXIT_FAILURE);
+                }
+                buf = nb;
+            }
+
+            ssize_t got = read(fd, buf + have, cap - have);
+            if (got < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    perror("read");
+                    free(buf);
+                    return false;
+                }
+                break; // drained
+            }
+            if (got == 0) {
+                eof = true;
+            }
+            uint64_t arrived = now_ns();
+            size_t   scan    = have;
+            have += (size_t)got;
+
+            // Apply every line completed by this read.
+            char *p = buf;
+            for (;;) {
+                char *nl = memchr(buf + scan, '\n', have - scan);
+                if (nl == NULL && !(eof && p < buf + have)) {
+                    break;
+                }
+                char *e = (nl != NULL) ? nl : buf + have;
+                if (stream_event(p, e, pos, part1, part2)) {
+                    st->events++;
+                    if (st->every > 0 &&
+                        st->events % (uint64_t)st->every == 0U) {
+                        snapshot(st->events, *pos, *part1, *part2);
+                    }
+                    record_latency(st, now_ns() - arrived);
+                }
+                p = (nl != NULL) ? nl + 1 : e;
+                scan = (size_t)(p - buf);
+            }
+            have -= (size_t)(p - buf);
+            memmove(buf, p, have);
+
+            if (eof || (st->interval_ms > 0 && arrived >= next_tick)) {
+                break; // keep periodic snapshots on time under load
+            }
+        }
+
+        if (st->interval_ms > 0 && now_ns() >= next_tick) {
+            snapshot(st->events, *pos, *part1, *part2);
+            next_tick += (uint64_t)st->interval_ms * 1000000U;
+        }
+    }
+
+    free(buf);
+    return true;
+}
+
+// O_NONBLOCK is set on the open file description, which the shell or the
+// rest of a pipeline may share, so the original flags go back on every way
+// out of --stream: normal and error returns, exit() from a bad line or out
+// of memory, and SIGINT/SIGTERM.
+static int stream_fd = -1;
+static int stream_flags;
+
+static void
+restore_stream_flags(void)
+{
+    if (stream_fd >= 0) {
+        (void)fcntl(stream_fd, F_SETFL, stream_flags);
+        stream_fd = -1;
+    }
+}
+
+static void
+stream_signal(int sig)
+{
+    if (stream_fd >= 0) {
+        (void)fcntl(stream_fd, F_SETFL, stream_flags);
+    }
+    signal(sig, SIG_DFL);
+    raise(sig);
+}
+
+static bool
+run_stream(int fd, StreamStats *st, int *pos, long long *part1,
+           long long *part2)
+{
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0) {
+        perror("fcntl");
+        return false;
+    }
+
+    stream_fd    = fd;
+    stream_flags = flags;
+    atexit(restore_stream_flags);
+    signal(SIGINT, stream_signal);
+    signal(SIGTERM, stream_signal);
+
+    bool ok = false;
+    if (fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0) {
+        perror("fcntl");
+    } else {
+        ok = stream_loop(fd, st, pos, part1, part2);
+    }
+    restore_stream_flags();
+    signal(SIGINT, SIG_DFL);
+    signal(SIGTERM, SIG_DFL);
+    return ok;
+}
+
+// --queries: prefix index over a loaded log.  Entry i describes the state
+// before rotation i, so the hits in rotations [i, j) are cum[j] - cum[i]
+// and each query is O(1) instead of a replay from the start.
+typedef struct {
+    size_t     n;    // rotations
+    size_t     cap;
+    uint16_t  *pos;  // pos[i]: dial before rotation i; pos[n] is the end
+    uint32_t  *cum1; // Part 1 hits in rotations [0, i)
+    long long *cum2; // Part 2 hits in rotations [0, i)
+} RotIndex;
+
+static void
+index_push(RotIndex *ix, int pos, long long part1, long long part2)
+{
+    if (ix->n + 1U >= ix->cap) {
+        ix->cap  = (ix->cap > 0U) ? ix->cap * 2U : 1024U;
+        ix->pos  = realloc(ix->pos, ix->cap * sizeof *ix->pos);
+        ix->cum1 = realloc(ix->cum1, ix->cap * sizeof *ix->cum1);
+        ix->cum2 = realloc(ix->cum2, ix->cap * sizeof *ix->cum2);
+        if (ix->pos == NULL || ix->cum1 == NULL || ix->cum2 == NULL) {
+            fprintf(stderr, "Out of memory\n");
+            exit(EXIT_FAILURE);
+        }
+    }
+    if (part1 > UINT32_MAX) {
+        fprintf(stderr, "Too many rotations to index\n");
+        exit(EXIT_FAILURE);
+    }
+    ix->pos[ix->n]  = (uint16_t)pos;
+    ix->cum1[ix->n] = (uint32_t)part1;
+    ix->cum2[ix->n] = part2;
+}
+
+static void
+index_load(FILE *fp, RotIndex *ix)
+{
+    int       pos   = mod_int(START_POS); // positions are stored in [0, m)
+    long long part1 = 0;
+    long long part2 = 0;
+    char     *line  = NULL;
+    size_t    lcap  = 0U;
+    ssize_t   len;
+
+    index_push(ix, pos, part1, part2);
+    while ((len = getline(&line, &lcap, fp)) >= 0) {
+        if (stream_event(line, line + len, &pos, &part1, &part2)) {
+            ix->n++;
+            index_push(ix, pos, part1, part2);
+        }
+    }
+    free(line);
+
+    if (ferror(fp)) {
+        fprintf(stderr, "Error reading input\n");
+        exit(EXIT_FAILURE);
+    }
+}
+
+static void
+index_free(RotIndex *ix)
+{
+    free(ix->pos);
+    free(ix->cum1);
+    free(ix->cum2);
+}
+
+// Each query line is "i j" with 0 <= i <= j <= n; the answer line is
+// "i j from to part1 part2": the dial before rotation i and j, and the hits
+// in rotations [i, j).
+static void
+run_queries(const RotIndex *ix, FILE *qf)
+{
+    char     *line = NULL;
+    size_t    lcap = 0U;
+    long long lineno = 0;
+
+    while (getline(&line, &lcap, qf) >= 0) {
+        lineno++;
+
+        char *p = line;
+        while (isspace((unsigned char)*p)) {
+            p++;
+        }
+        if (*p == '\0') {
+            continue;
+        }
+
+        // Both indices must be present: strtoull leaves end where it
+        // started when it finds no digits, and would read "0" as "0 0".
+        char *mid;
+        char *end;
+        errno = 0;
+        unsigned long long i = strtoull(p, &mid, 10);
+        unsigned long long j = strtoull(mid, &end, 10);
+        bool two = mid != p && end != mid && isspace((unsigned char)*mid);
+        while (isspace((unsigned char)*end)) {
+            end++;
+        }
+        if (!two || errno != 0 || *end != '\0' || i > j || j > ix->n) {
+            fprintf(stderr, "Bad query on line %lld (0 <= i <= j <= %zu)\n",
+                    lineno, ix->n);
+            exit(EXIT_FAILURE);
+        }
+
+        printf("%llu %llu %d %d %lld %lld\n", i, j, ix->pos[i], ix->pos[j],
+               (long long)ix->cum1[j] - (long long)ix->cum1[i],
+               ix->cum2[j] - ix->cum2[i]);
+    }
+    free(line);
+}
+
+static void
+usage(const char *prog)
+{
+    fprintf(stderr,
+            "usage: %s [--modulus M] [--threads N]\n"
+            "       %s [--modulus M] --stream [--every N] [--interval MS]"
+            " [--stats PATH|-]\n"
+            "       %s [--modulus M] --queries PATH|- [--input PATH]\n",
+            prog, prog, prog);
+    exit(EXIT_FAILURE);
+}
+
 int
-main(void)
+main(int argc, char **argv)
 {
-    int        pos   = 50;
-    long long  part1 = 0;
-    long long  part2 = 0;
+    int        pos      = START_POS;
+    long long  part1    = 0;
+    long long  part2    = 0;
+    int        nthreads = 1;
+    bool       stream   = false;
+    const char *stats   = NULL;
+    const char *queries = NULL;
+    const char *input   = NULL;
+    StreamStats st      = { .every = 1 };
+    uint32_t   modulus  = DEFAULT_MODULUS;
+
+    for (int i = 1; i < argc; i++) {
+        if (strcmp(argv[i], "--stream") == 0) {
+            stream = true;
+        } else if (strcmp(argv[i], "--stats") == 0 && i + 1 < argc) {
+            stats = argv[++i];
+        } else if (strcmp(argv[i], "--queries") == 0 && i + 1 < argc) {
+            queries = argv[++i];
+        } else if (strcmp(argv[i], "--input") == 0 && i + 1 < argc) {
+            input = argv[++i];
+        } else if ((strcmp(argv[i], "--threads") == 0 ||
+                    strcmp(argv[i], "--modulus") == 0 ||
+                    strcmp(argv[i], "--every") == 0 ||
+                    strcmp(argv[i], "--interval") == 0) && i + 1 < argc) {
+            const char *opt = argv[i];
+            char       *end = NULL;
+            long        v   = strtol(argv[++i], &end, 10);
+            if (*end != '\0' || v < 0) {
+                usage(argv[0]);
+            }
+            if (strcmp(opt, "--threads") == 0) {
+                if (v < 1 || v > MAX_THREADS) {
+                    fprintf(stderr, "--threads must be 1..%d\n",
+                            MAX_THREADS);
+                    return EXIT_FAILURE;
+                }
+                nthreads = (int)v;
+            } else if (strcmp(opt, "--modulus") == 0) {
+                if (v < 1 || v > MAX_MODULUS) {
+                    fprintf(stderr, "--modulus must be 1..%d\n",
+                            MAX_MODULUS);
+                    return EXIT_FAILURE;
+                }
+                modulus = (uint32_t)v;
+            } else if (strcmp(opt, "--every") == 0) {
+                st.every = v;
+            } else {
+                st.interval_ms = v;
+            }
+        } else {
+            usage(argv[0]);
+        }
+    }
+    dial_select(modulus);
+    pos = mod_int(pos);
+
+    if (queries != NULL) {
+        bool  q_stdin = (strcmp(queries, "-") == 0);
+        FILE *in = (input != NULL) ? fopen(input, "r") : stdin;
+        FILE *qf = q_stdin ? stdin : fopen(queries, "r");
+
+        if (q_stdin && input == NULL) {
+            fprintf(stderr, "--queries - needs --input PATH\n");
+            return EXIT_FAILURE;
+        }
+        if (in == NULL || qf == NULL) {
+            perror((in == NULL) ? input : queries);
+            return EXIT_FAILURE;
+        }
+
+        RotIndex ix = {0};
+        index_load(in, &ix);
+        run_queries(&ix, qf);
+        index_free(&ix);
+        return EXIT_SUCCESS;
+    }
+
+    if (stream) {
+        double t0 = (double)now_ns();
+        if (!run_stream(fileno(stdin), &st, &pos, &part1, &part2)) {
+            return EXIT_FAILURE;
+        }
+        if (stats != NULL) {
+            write_stream_stats(stats, &st, ((double)now_ns() - t0) * 1e-9,
+                               part2);
+        }
+        printf("Part 1: %lld\n", part1);
+        printf("Part 2: %lld\n", part2);
+        return EXIT_SUCCESS;
+    }
 
     // if stdin is a terminal, use embedded sample.
     bool use_sample = false;
@@ -144,23 +1123,10 @@ main(void)
             process_line(sample_data[i], &pos, &part1, &part2);
         }
     } else {
-        char buf[LINE_BUF_SIZE];
-
-        while (fgets(buf, (int)sizeof buf, stdin) != NULL) {
-            size_t len = strlen(buf);
-            if (len > 0U && buf[len - 1U] == '\n') {
-                buf[len - 1U] = '\0';
-            }
-
-            trim_whitespace(buf);
-            if (buf[0] == '\0') {
-                continue;
-            }
-
-            process_line(buf, &pos, &part1, &part2);
-        }
-
-        if (ferror(stdin)) {
+        bool ok = (nthreads > 1)
+                ? run_threaded(stdin, nthreads, &pos, &part1, &part2)
+                : run_batched(stdin, &pos, &part1, &part2);
+        if (!ok) {
             fprintf(stderr, "Error reading stdin\n");
             return EXIT_FAILURE;
         }
@@ -1,351 +1,417 @@
 #include "./lib/aoc.h"
 #include <inttypes.h>
+#include <threads.h>
 
-typedef struct Span {
-    u64 lo;
-    u64 hi;
-} Span; // [log, hi] inclusive range of IDs
-
-#ifndef MAX_SPANS
-#define MAX_SPANS 4096
-#endif
+// IDs up to 39 digits.  Spans are parsed as u128; when every span fits in
+// 64 bits (the usual case) the u64 instance of the kernels runs instead.
+__extension__ typedef unsigned __int128 u128;
 
-#ifndef MAX_IDS
-#define MAX_IDS 200000
-#endif
+#define U128_MAX (~(u128)0)
 
-// a scale = 10^k
-static u64 block_scales[32];
+typedef struct Span {
+    u128 lo;
+    u128 hi;
+} Span; // [log, hi] inclusive range of IDs
 
-static void
-prepare_block_scales(void)
-{
-    block_scales[0] = 1U;
-    for (u32 i = 1U; i < ARRAY_LEN(block_scales); i++) {
-        if (block_scales[i - 1U] > UINT64_MAX / 10U)
-            block_scales[i] = UINT64_MAX;
-        else
-            block_scales[i] = block_scales[i - 1U] * 10U;
-    }
-}
+#define MAX_THREADS 256
 
-static u64
-block_scale(u32 exp)
-{
-    if (exp >= ARRAY_LEN(block_scales))
-        return UINT64_MAX;
-    return block_scales[exp];
-}
-
-static int
-cmp_u64(const void *lhs, const void *rhs)
-{
-    const u64 a = *(const u64 *)lhs;
-    const u64 b = *(const u64 *)rhs;
-    return (a > b) - (a < b);
-}
+#define READ_CHUNK (1U << 20)
 
+// Parses "lo-hi" from [s, e) in place.  Whitespace anywhere in the token is
+// ignored, as the old strip_spaces() copy did.
 static bool
-parse_span(const char *s, Span *out)
+parse_span(const char *s, const char *e, Span *out)
 {
-    const char *p = s;
-    u64 lo = 0U, hi = 0U;
-
-    if (!s || !out)
-        return false;
-
-    if (!isdigit((unsigned char)*p))
-        return false;
-
-    while (*p && isdigit((unsigned char)*p))
-        lo = lo * 10U + (u64)(*p++ - '0');
-
-    if (*p++ != '-')
-        return false;
+    u128 v[2] = { 0U, 0U };
+    u32 ndig[2] = { 0U, 0U };
+    int part = 0;
 
-    if (!isdigit((unsigned char)*p))
-        return false;
+    for (const char *p = s; p < e; p++) {
+        unsigned char c = (unsigned char)*p;
 
-    while (*p && isdigit((unsigned char)*p))
-        hi = hi * 10U + (u64)(*p++ - '0');
+        if (isspace(c))
+            continue;
+        if (c == '-' && part == 0 && ndig[0] > 0U) {
+            part = 1;
+            continue;
+        }
+        if (!isdigit(c))
+            return false;
+
+        u32 dig = (u32)(c - '0');
+        if (v[part] > (U128_MAX - dig) / 10U)
+            return false; // more than 128 bits
+        v[part] = v[part] * 10U + dig;
+        ndig[part]++;
+    }
 
-    if (*p != '\0')
+    if (part != 1 || ndig[1] == 0U)
         return false;
 
-    out->lo = lo;
-    out->hi = hi;
+    out->lo = v[0];
+    out->hi = v[1];
     return true;
 }
 
-static size_t
-load_spans(Span *spans, size_t cap)
+static void
+add_span(const char *s, const char *e, Span **spans, size_t *n, size_t *cap)
 {
-    char line[4096];
-    size_t n = 0U;
-
-    while (read_line(stdin, line, sizeof line)) {
-        char *p = line;
-        if (is_blank_line(p))
-            continue;
-
-        while (*p) {
-            char tok[256];
-            size_t k = 0U;
+    const char *p = s;
 
-            while (*p && (isspace((unsigned char)*p) || *p == ','))
-                p++;
-            if (!*p)
-                break;
+    while (p < e && isspace((unsigned char)*p))
+        p++;
+    if (p == e)
+        return; // empty token or blank line
 
-            while (*p && *p != ',') {
-                if (k + 1U < ARRAY_LEN(tok))
-                    tok[k++] = *p;
-                p++;
-            }
-            tok[k] = '\0';
-            strip_spaces(tok);
-            if (!tok[0])
-                continue;
-
-            if (n >= cap) {
-                fprintf(stderr, "too many spans\n");
-                exit(EXIT_FAILURE);
-            }
-
-            if (!parse_span(tok, &spans[n++])) {
-                fprintf(stderr, "bad span token '%s'\n", tok);
-                exit(EXIT_FAILURE);
-            }
-        }
+    if (*n == *cap) {
+        *cap = *cap ? *cap * 2U : 1024U;
+        *spans = xrealloc(*spans, *cap * sizeof **spans);
     }
 
-    return n;
-}
-
-static u64
-sum_pair_ids_for_blocklen(u32 len, u64 lo, u64 hi, u64 max_id)
-{
-    u32 e2 = 2U * len - 1U;
-    u64 min2 = block_scale(e2);
-    u64 base = block_scale(len);
-    u64 blk_min = block_scale(len - 1U);
-
-    if (min2 == UINT64_MAX || min2 > max_id)
-        return 0U;
-    if (base == UINT64_MAX || blk_min == UINT64_MAX)
-        return 0U;
-
-    u64 blk_max = base - 1U;
-    u64 m = base + 1U;
-
-    u64 x_lo = (lo + m - 1U) / m;
-    u64 x_hi = hi / m;
-
-    u64 start = x_lo > blk_min ? x_lo : blk_min;
-    u64 end   = x_hi < blk_max ? x_hi : blk_max;
-
-    if (start > end)
-        return 0U;
-
-    u64 cnt = end - start + 1U;
-    u64 sumx = (start + end) * cnt / 2U;
-
-    return m * sumx;
-}
-
-static u64
-sum_pair_ids(u64 lo, u64 hi, u64 max_id)
-{
-    u64 sum = 0U;
-    for (u32 len = 1U;; len++) {
-        u32 e2 = 2U * len - 1U;
-        u64 min2 = block_scale(e2);
-        if (min2 == UINT64_MAX || min2 > max_id)
-            break;
-        sum += sum_pair_ids_for_blocklen(len, lo, hi, max_id);
+    if (!parse_span(s, e, &(*spans)[*n])) {
+        fputs("bad span token '", stderr);
+        for (p = s; p < e; p++)
+            if (!isspace((unsigned char)*p))
+                fputc(*p, stderr);
+        fputs("'\n", stderr);
+        exit(EXIT_FAILURE);
     }
-    return sum;
+    (*n)++;
 }
 
-static void
-collect_repeats_for_blocklen(u32 len,
-                              u64 max_id,
-                              u64 *ids,
-                              size_t cap,
-                              size_t *n_ptr)
+// Streams fp in READ_CHUNK blocks.  Tokens end at ',' or a newline and are
+// parsed where they lie in the buffer; only an unfinished tail token is
+// moved to the front before the next read, so neither lines nor tokens have
+// a length limit.
+static Span *
+load_spans(FILE *fp, size_t *count)
 {
-    u64 base = block_scale(len);
-    u64 blk_min = block_scale(len - 1U);
-    if (base == UINT64_MAX || base == 0 || blk_min == UINT64_MAX)
-        return;
-
-    u64 blk_max = base - 1U;
-
-    for (u32 rep = 2U;; rep++) {
-        u64 pow_bt = 1U;
-
-        if (rep == 2U) {
-            if (base > UINT64_MAX / base)
-                break;
-            pow_bt = base * base;
-        } else {
-            for (u32 i = 0U; i < rep; i++) {
-                if (base != 0 && pow_bt > UINT64_MAX / base) {
-                    pow_bt = 0U;
-                    break;
-                }
-                pow_bt *= base;
-            }
+    size_t cap = READ_CHUNK;
+    size_t have = 0U;
+    char *buf = xrealloc(NULL, cap);
+    Span *spans = NULL;
+    size_t n = 0U, span_cap = 0U;
+    bool eof = false;
+
+    while (!eof) {
+        if (have == cap) {
+            cap *= 2U; // one token longer than the buffer
+            buf = xrealloc(buf, cap);
         }
 
-        if (pow_bt == 0U)
-            break;
-
-        u64 m = (pow_bt - 1U) / (base - 1U);
-        u64 min_id = blk_min * m;
-        if (min_id > max_id)
-            break;
-
-        u64 blk_cap = max_id / m;
-        if (blk_cap > blk_max)
-            blk_cap = blk_max;
-
-        if (blk_min > blk_cap)
-            continue;
-
-        for (u64 x = blk_min; x <= blk_cap; x++) {
-            u64 id = x * m;
-            if (id > max_id)
-                break;
+        size_t got = fread(buf + have, 1U, cap - have, fp);
+        eof = (got == 0U);
+        have += got;
 
-            if (*n_ptr >= cap) {
-                fprintf(stderr, "too many ids\n");
-                exit(EXIT_FAILURE);
+        char *p = buf;
+        char *end = buf + have;
+        for (char *q = p; q < end; q++) {
+            if (*q == ',' || *q == '\n') {
+                add_span(p, q, &spans, &n, &span_cap);
+                p = q + 1;
             }
-            ids[*n_ptr] = id;
-            (*n_ptr)++;
         }
-    }
-}
-
-static void
-collect_repeat_ids(u64 max_id, u64 *ids, size_t cap, size_t *out_n)
-{
-    size_t n = 0U;
-
-    for (u32 len = 1U;; len++) {
-        u32 e2 = 2U * len - 1U;
-        u64 min2 = block_scale(e2);
+        if (eof) {
+            add_span(p, end, &spans, &n, &span_cap);
+            p = end;
+        }
 
-        if (min2 == UINT64_MAX || min2 > max_id)
-            break;
+        have = (size_t)(end - p);
+        memmove(buf, p, have);
+    }
 
-        collect_repeats_for_blocklen(len, max_id, ids, cap, &n);
+    if (ferror(fp)) {
+        fprintf(stderr, "read error\n");
+        exit(EXIT_FAILURE);
     }
 
-    *out_n = n;
+    free(buf);
+    *count = n;
+    return spans;
 }
 
-static void
-uniq_ids(u64 *ids, size_t *n_ptr)
+static int
+moebius(u32 n)
 {
-    size_t n = *n_ptr;
-    size_t w = 0U;
+    int mu = 1;
 
-    for (size_t i = 0; i < n; i++) {
-        if (w == 0 || ids[i] != ids[w - 1])
-            ids[w++] = ids[i];
+    for (u32 p = 2U; p * p <= n; p++) {
+        if (n % p)
+            continue;
+        n /= p;
+        if (n % p == 0U)
+            return 0;
+        mu = -mu;
     }
-
-    *n_ptr = w;
+    if (n > 1U)
+        mu = -mu;
+    return mu;
 }
 
-static void
-build_psum(const u64 *vals, size_t n, u64 *psum)
-{
-    u64 s = 0;
-    psum[0] = 0;
-    for (size_t i = 0; i < n; i++) {
-        s += vals[i];
-        psum[i + 1] = s;
+// SPAN_KERNELS(W, T, T_MAX, DIGITS) instantiates the Part 1 and Part 2
+// sums for IDs of unsigned type T (at most DIGITS decimal digits).  All
+// arithmetic is mod 2^bits(T), like the printed answers.
+//
+// Part 1 counts block-twice IDs x * (10^len + 1).  Part 2 works per digit
+// length D: S_b (block length b | D repeated D/b times) satisfies
+// S_b & S_c = S_gcd, so by Moebius inversion the union over proper divisors
+// b < D is -sum_{b | D, b < D} mu(D/b) * sum(S_b), and each sum(S_b) is an
+// arithmetic series times the repunit R = sum 10^(b*k).
+#define SPAN_KERNELS(W, T, T_MAX, DIGITS)                                 \
+    /* a scale = 10^k, saturating at T_MAX */                             \
+    static T block_scales_##W[(DIGITS) + 1U];                             \
+                                                                          \
+    static void                                                           \
+    prepare_block_scales_##W(void)                                        \
+    {                                                                     \
+        block_scales_##W[0] = 1U;                                         \
+        for (u32 i = 1U; i < ARRAY_LEN(block_scales_##W); i++) {          \
+            if (block_scales_##W[i - 1U] > (T_MAX) / 10U)                 \
+                block_scales_##W[i] = (T_MAX);                            \
+            else                                                          \
+                block_scales_##W[i] = block_scales_##W[i - 1U] * 10U;     \
+        }                                                                 \
+    }                                                                     \
+                                                                          \
+    static T                                                              \
+    block_scale_##W(u32 exp)                                              \
+    {                                                                     \
+        if (exp >= ARRAY_LEN(block_scales_##W))                           \
+            return (T_MAX);                                               \
+        return block_scales_##W[exp];                                     \
+    }                                                                     \
+                                                                          \
+    /* start + ... + end; halves the even factor before multiplying */    \
+    static T                                                              \
+    series_sum_##W(T start, T end)                                        \
+    {                                                                     \
+        T cnt = end - start + 1U;                                         \
+                                                                          \
+        if (cnt % 2U == 0U)                                               \
+            return (cnt / 2U) * (start + end);                            \
+        return cnt * (start + (end - start) / 2U);                        \
+    }                                                                     \
+                                                                          \
+    static T                                                              \
+    sum_pair_ids_for_blocklen_##W(u32 len, T lo, T hi, T max_id)          \
+    {                                                                     \
+        u32 e2 = 2U * len - 1U;                                           \
+        T min2 = block_scale_##W(e2);                                     \
+        T base = block_scale_##W(len);                                    \
+        T blk_min = block_scale_##W(len - 1U);                            \
+                                                                          \
+        if (min2 == (T_MAX) || min2 > max_id)                             \
+            return 0U;                                                    \
+        if (base == (T_MAX) || blk_min == (T_MAX))                        \
+            return 0U;                                                    \
+                                                                          \
+        T blk_max = base - 1U;                                            \
+        T m = base + 1U;                                                  \
+                                                                          \
+        T x_lo = lo / m + (lo % m != 0U);                                 \
+        T x_hi = hi / m;                                                  \
+                                                                          \
+        T start = x_lo > blk_min ? x_lo : blk_min;                        \
+        T end   = x_hi < blk_max ? x_hi : blk_max;                        \
+                                                                          \
+        if (start > end)                                                  \
+            return 0U;                                                    \
+                                                                          \
+        return m * series_sum_##W(start, end);                            \
+    }                                                                     \
+                                                                          \
+    static T                                                              \
+    sum_pair_ids_##W(T lo, T hi, T max_id)                                \
+    {                                                                     \
+        T sum = 0U;                                                       \
+        for (u32 len = 1U;; len++) {                                      \
+            u32 e2 = 2U * len - 1U;                                       \
+            T min2 = block_scale_##W(e2);                                 \
+            if (min2 == (T_MAX) || min2 > max_id)                         \
+                break;                                                    \
+            sum += sum_pair_ids_for_blocklen_##W(len, lo, hi, max_id);    \
+        }                                                                 \
+        return sum;                                                       \
+    }                                                                     \
+                                                                          \
+    /* IDs in [lo, hi] made of a len-digit block written rep times */     \
+    static T                                                              \
+    sum_block_ids_##W(u32 len, u32 rep, T lo, T hi)                       \
+    {                                                                     \
+        T base = block_scale_##W(len);                                    \
+        T blk_min = block_scale_##W(len - 1U);                            \
+        T r = 0U;                                                         \
+                                                                          \
+        for (u32 k = 0U; k < rep; k++)                                    \
+            r = r * base + 1U;                                            \
+                                                                          \
+        T x_lo = lo / r + (lo % r != 0U);                                 \
+        T x_hi = hi / r;                                                  \
+        T start = x_lo > blk_min ? x_lo : blk_min;                        \
+        T end   = x_hi < base - 1U ? x_hi : base - 1U;                    \
+                                                                          \
+        if (start > end)                                                  \
+            return 0U;                                                    \
+        return r * series_sum_##W(start, end);                            \
+    }                                                                     \
+                                                                          \
+    static T                                                              \
+    sum_repeat_ids_##W(T lo, T hi)                                        \
+    {                                                                     \
+        T sum = 0U;                                                       \
+                                                                          \
+        for (u32 d = 2U; d <= (DIGITS); d++) {                            \
+            T d_lo = block_scale_##W(d - 1U);                             \
+            T d_hi = d < (DIGITS) ? block_scale_##W(d) - 1U : (T_MAX);    \
+                                                                          \
+            if (d_lo > hi)                                                \
+                break;                                                    \
+            if (d_hi < lo)                                                \
+                continue;                                                 \
+            if (d_lo < lo)                                                \
+                d_lo = lo;                                                \
+            if (d_hi > hi)                                                \
+                d_hi = hi;                                                \
+                                                                          \
+            for (u32 b = 1U; b < d; b++) {                                \
+                if (d % b)                                                \
+                    continue;                                             \
+                int mu = moebius(d / b);                                  \
+                if (mu > 0)                                               \
+                    sum -= sum_block_ids_##W(b, d / b, d_lo, d_hi);       \
+                else if (mu < 0)                                          \
+                    sum += sum_block_ids_##W(b, d / b, d_lo, d_hi);       \
+            }                                                             \
+        }                                                                 \
+        return sum;                                                       \
+    }                                                                     \
+                                                                          \
+    typedef struct {                                                      \
+        const Span *spans;                                                \
+        size_t n;                                                         \
+        T max_id;                                                         \
+        T part1;                                                          \
+        T part2;                                                          \
+    } SpanJob_##W;                                                        \
+                                                                          \
+    static int                                                            \
+    span_job_##W(void *arg)                                               \
+    {                                                                     \
+        SpanJob_##W *job = arg;                                           \
+                                                                          \
+        job->part1 = 0U;                                                  \
+        job->part2 = 0U;                                                  \
+        for (size_t i = 0; i < job->n; i++) {                             \
+            T lo = (T)job->spans[i].lo;                                   \
+            T hi = (T)job->spans[i].hi;                                   \
+            job->part1 += sum_pair_ids_##W(lo, hi, job->max_id);          \
+            job->part2 += sum_repeat_ids_##W(lo, hi);                     \
+        }                                                                 \
+        return 0;                                                         \
+    }                                                                     \
+                                                                          \
+    /* Spans are independent and the sums are mod 2^bits(T), so the      \
+     * per-thread partial sums add up to exactly the sequential result. */ \
+    static void                                                           \
+    solve_##W(const Span *spans, size_t n, int nthreads, T *part1,        \
+              T *part2)                                                   \
+    {                                                                     \
+        SpanJob_##W job[MAX_THREADS];                                     \
+        thrd_t tid[MAX_THREADS];                                          \
+        T max_id = 0U;                                                    \
+                                                                          \
+        prepare_block_scales_##W();                                       \
+        for (size_t i = 0; i < n; i++)                                    \
+            if ((T)spans[i].hi > max_id)                                  \
+                max_id = (T)spans[i].hi;                                  \
+                                                                          \
+        if ((size_t)nthreads > n)                                         \
+            nthreads = (int)n;                                            \
+        for (int t = 0; t < nthreads; t++) {                              \
+            size_t a = n * (size_t)t / (size_t)nthreads;                  \
+            size_t b = n * (size_t)(t + 1) / (size_t)nthreads;            \
+            job[t] = (SpanJob_##W){ spans + a, b - a, max_id, 0U, 0U };   \
+        }                                                                 \
+        for (int t = 1; t < nthreads; t++) {                              \
+            if (thrd_create(&tid[t], span_job_##W, &job[t]) !=            \
+                thrd_success) {                                           \
+                fprintf(stderr, "thrd_create failed\n");                  \
+                exit(EXIT_FAILURE);                                       \
+            }                                                             \
+        }                                                                 \
+        span_job_##W(&job[0]);                                            \
+                                                                          \
+        *part1 = job[0].part1;                                            \
+        *part2 = job[0].part2;                                            \
+        for (int t = 1; t < nthreads; t++) {                              \
+            thrd_join(tid[t], NULL);                                      \
+            *part1 += job[t].part1;                                       \
+            *part2 += job[t].part2;                                       \
+        }                                                                 \
     }
-}
 
-static size_t
-lb(const u64 *a, size_t n, u64 key)
-{
-    size_t lo = 0, hi = n;
-    while (lo < hi) {
-        size_t m = lo + (hi - lo) / 2;
-        if (a[m] < key) lo = m + 1;
-        else hi = m;
-    }
-    return lo;
-}
+SPAN_KERNELS(64, u64, UINT64_MAX, 20U)
+SPAN_KERNELS(128, u128, U128_MAX, 39U)
 
-static size_t
-ub(const u64 *a, size_t n, u64 key)
+static void
+print_u128(const char *label, u128 v)
 {
-    size_t lo = 0, hi = n;
-    while (lo < hi) {
-        size_t m = lo + (hi - lo) / 2;
-        if (a[m] <= key) lo = m + 1;
-        else hi = m;
-    }
-    return lo;
-}
+    char buf[40];
+    size_t k = sizeof buf;
 
-static u64
-sum_repeat_ids(const u64 *ids,
-               size_t n,
-               const u64 *psum,
-               u64 lo,
-               u64 hi)
-{
-    size_t L = lb(ids, n, lo);
-    size_t R = ub(ids, n, hi);
-    if (L >= R)
-        return 0U;
-    return psum[R] - psum[L];
+    buf[--k] = '\0';
+    do {
+        buf[--k] = (char)('0' + (u32)(v % 10U));
+        v /= 10U;
+    } while (v != 0U);
+
+    printf("%s%s\n", label, buf + k);
 }
 
 int
-main(void)
+main(int argc, char **argv)
 {
-    Span spans[MAX_SPANS];
+    Span *spans;
     size_t span_count;
-    u64 max_id = 0U;
-    u64 part1 = 0U, part2 = 0U;
-    u64 ids[MAX_IDS];
-    size_t id_count = 0U;
-    u64 psum[MAX_IDS + 1U];
-
-    prepare_block_scales();
+    bool wide = false;
+    int nthreads = 1;
+
+    for (int i = 1; i < argc; i++) {
+        char *end = NULL;
+        long v = 0;
+
+        if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc)
+            v = strtol(argv[++i], &end, 10);
+        if (end == NULL || *end != '\0' || v < 1 || v > MAX_THREADS) {
+            fprintf(stderr, "usage: %s [--threads 1..%d]\n", argv[0],
+                    MAX_THREADS);
+            return EXIT_FAILURE;
+        }
+        nthreads = (int)v;
+    }
 
-    span_count = load_spans(spans, MAX_SPANS);
+    spans = load_spans(stdin, &span_count);
     if (!span_count) {
         fprintf(stderr, "no spans\n");
         return EXIT_FAILURE;
     }
 
     for (size_t i = 0; i < span_count; i++)
-        if (spans[i].hi > max_id)
-            max_id = spans[i].hi;
-
-    for (size_t i = 0; i < span_count; i++)
-        part1 += sum_pair_ids(spans[i].lo, spans[i].hi, max_id);
-
-    collect_repeat_ids(max_id, ids, MAX_IDS, &id_count);
-    qsort(ids, id_count, sizeof(u64), cmp_u64);
-    uniq_ids(ids, &id_count);
-    build_psum(ids, id_count, psum);
-
-    for (size_t i = 0; i < span_count; i++)
-        part2 += sum_repeat_ids(ids, id_count, psum,
-                                spans[i].lo, spans[i].hi);
+        if (spans[i].hi > UINT64_MAX || spans[i].lo > UINT64_MAX)
+            wide = true;
+
+    if (wide) {
+        u128 part1, part2;
+        solve_128(spans, span_count, nthreads, &part1, &part2);
+        print_u128("Part 1: ", part1);
+        print_u128("Part 2: ", part2);
+    } else {
+        u64 part1, part2;
+        solve_64(spans, span_count, nthreads, &part1, &part2);
+        printf("Part 1: %" PRIu64 "\n", part1);
+        printf("Part 2: %" PRIu64 "\n", part2);
+    }
 
-    printf("Part 1: %" PRIu64 "\n", part1);
-    printf("Part 2: %" PRIu64 "\n", part2);
+    free(spans);
     return EXIT_SUCCESS;
 }
-
@@ -5,11 +5,18 @@
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <threads.h>
 
-#define MAX_BANKS 4096
-#define MAX_WIDTH 256
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# include <immintrin.h>
+#endif
 
-static char sample_banks[][MAX_WIDTH + 1U] = {
+#define READ_CHUNK (1U << 20)
+#define MAX_K 64    // longest pick; sizes the Dec accumulator
+#define MAX_PICK 19 // longest pick that fits in a u64
+#define MAX_THREADS 256
+
+static const char *sample_banks[] = {
 	"987654321111111",
 	"811111111111119",
 	"234234234234278",
@@ -18,150 +25,467 @@ static char sample_banks[][MAX_WIDTH + 1U] = {
 
 #define SAMPLE_BANK_COUNT (sizeof(sample_banks) / sizeof(sample_banks[0]))
 
-static u32
-best_bank(const char *s)
+// Exact decimal values for picks longer than MAX_PICK digits: little-endian
+// limbs of 18 digits each, with two spare limbs so totals over any
+// realistic number of banks cannot overflow.
+#define DEC_BASE 1000000000000000000ULL
+#define DEC_DIGITS 18
+#define DEC_LIMBS ((MAX_K + DEC_DIGITS - 1) / DEC_DIGITS + 2)
+
+typedef struct {
+	u64 limb[DEC_LIMBS];
+} Dec;
+
+static void
+dec_carry(Dec *d, size_t i, u64 carry)
 {
-	size_t len;
-	u8 best_right;
-	u32 best = 0U;
+	for (; carry != 0U && i < DEC_LIMBS; i++) {
+		u64 v = d->limb[i] + carry;
+		carry = v / DEC_BASE;
+		d->limb[i] = v % DEC_BASE;
+	}
+	assert(carry == 0U);
+}
 
-	if (s == NULL) {
-		return 0U;
+static void
+dec_add_u64(Dec *d, u64 v)
+{
+	u64 lo = d->limb[0] + v % DEC_BASE;
+
+	d->limb[0] = lo % DEC_BASE;
+	dec_carry(d, 1U, v / DEC_BASE + lo / DEC_BASE);
+}
+
+static void
+dec_add(Dec *d, const Dec *x)
+{
+	u64 carry = 0U;
+
+	for (size_t i = 0U; i < DEC_LIMBS; i++) {
+		u64 v = d->limb[i] + x->limb[i] + carry;
+		carry = v / DEC_BASE;
+		d->limb[i] = v % DEC_BASE;
 	}
-	len = strlen(s);
-	if (len < 2U) {
-		return 0U;
+	assert(carry == 0U);
+}
+
+// d = the n ASCII digits at s, most significant first.
+static void
+dec_set_digits(Dec *d, const char *s, size_t n)
+{
+	for (size_t i = 0U; i < DEC_LIMBS; i++) {
+		size_t w = (n < DEC_DIGITS) ? n : DEC_DIGITS;
+		u64 v = 0U;
+
+		n -= w;
+		for (size_t j = 0U; j < w; j++) {
+			v = v * 10U + (u64)(s[n + j] - '0');
+		}
+		d->limb[i] = v;
+	}
+}
+
+static void
+dec_print(const char *label, const Dec *d)
+{
+	size_t top = DEC_LIMBS - 1U;
+
+	while (top > 0U && d->limb[top] == 0U) {
+		top--;
 	}
-	best_right = (u8)(s[len - 1U] - '0');
-	for (size_t i = len - 1U; i > 0U; i--) {
-		size_t pos = i - 1U;
-		u8 d = (u8)(s[pos] - '0');
-		u32 N = (u32)(10U * d + best_right);
-		if (N > best) {
-			best = N;
+	printf("%s%" PRIu64, label, d->limb[top]);
+	while (top-- > 0U) {
+		printf("%0*" PRIu64, DEC_DIGITS, d->limb[top]);
+	}
+	putchar('\n');
+}
+
+// The k digits of s[0..len) kept in order that form the largest number, or
+// all of them when len <= k; returns how many were written to out.  One
+// pass with a monotonic stack: a digit pops smaller digits before it as
+// long as enough digits remain to refill the stack to k.
+static size_t
+pick_digits(const char *s, size_t len, size_t k, char *out)
+{
+	size_t top = 0U;
+
+	for (size_t i = 0U; i < len; i++) {
+		char ch = s[i];
+		while (top > 0U && out[top - 1U] < ch &&
+		    top - 1U + (len - i) >= k) {
+			top--;
 		}
-		if (d > best_right) {
-			best_right = d;
+		if (top < k) {
+			out[top++] = ch;
 		}
 	}
-	return best;
+	return top;
 }
 
-// Part 2
-static u64
-output_joltage(const char *s)
+// Adds the best k-digit pick of s[0..len) to total.  Picks of up to
+// MAX_PICK digits are folded in a u64; longer ones go through Dec.
+static void
+add_joltage(Dec *total, const char *s, size_t len, size_t k)
 {
-	const size_t k = 12U;
-	size_t start = 0U;
-	u64 val = 0U;
-	size_t len;
+	char digits[MAX_K];
+	size_t n;
 
-	if (s == NULL) {
-		return 0U;
+	assert(k <= MAX_K);
+	n = pick_digits(s, len, k, digits);
+	if (k <= MAX_PICK) {
+		u64 val = 0U;
+
+		for (size_t i = 0U; i < n; i++) {
+			val = val * 10U + (u64)(digits[i] - '0');
+		}
+		dec_add_u64(total, val);
+	} else {
+		Dec val;
+
+		dec_set_digits(&val, digits, n);
+		dec_add(total, &val);
+	}
+}
+
+// Part 1 kernels.  The best two-digit pick takes the largest digit among
+// the first len - 1 as the tens (its first occurrence leaves the most room)
+// and the largest digit after it as the units, so a bank costs two byte-max
+// reductions and a memchr.  max_byte is chosen at startup: AVX2 or SSE2 on
+// x86-64, a scalar loop elsewhere.
+static u8
+max_byte_scalar(const u8 *s, size_t n)
+{
+	u8 m = 0U;
+
+	for (size_t i = 0U; i < n; i++) {
+		if (s[i] > m) {
+			m = s[i];
+		}
+	}
+	return m;
+}
+
+#if defined(__x86_64__) && (defined(__GNUC__) || defined(__clang__))
+# define HAVE_X86_KERNELS 1
+
+__attribute__((target("sse2"))) static u8
+hmax_epu8(__m128i v)
+{
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 8));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 4));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 2));
+	v = _mm_max_epu8(v, _mm_srli_si128(v, 1));
+	return (u8)_mm_cvtsi128_si32(v);
+}
+
+__attribute__((target("sse2"))) static u8
+max_byte_sse2(const u8 *s, size_t n)
+{
+	__m128i m = _mm_setzero_si128();
+	size_t i = 0U;
+
+	for (; i + 16U <= n; i += 16U) {
+		m = _mm_max_epu8(m, _mm_loadu_si128((const __m128i *)(s + i)));
+	}
+	u8 best = hmax_epu8(m);
+	u8 tail = max_byte_scalar(s + i, n - i);
+	return tail > best ? tail : best;
+}
+
+__attribute__((target("avx2"))) static u8
+max_byte_avx2(const u8 *s, size_t n)
+{
+	__m256i m = _mm256_setzero_si256();
+	size_t i = 0U;
+
+	for (; i + 32U <= n; i += 32U) {
+		m = _mm256_max_epu8(m,
+		    _mm256_loadu_si256((const __m256i *)(s + i)));
+	}
+	u8 best = hmax_epu8(_mm_max_epu8(_mm256_castsi256_si128(m),
+	    _mm256_extracti128_si256(m, 1)));
+	u8 tail = max_byte_sse2(s + i, n - i);
+	return tail > best ? tail : best;
+}
+#endif
+
+static u8 (*max_byte)(const u8 *s, size_t n) = max_byte_scalar;
+
+static void
+select_kernels(void)
+{
+#ifdef HAVE_X86_KERNELS
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		max_byte = max_byte_avx2;
+	} else {
+		max_byte = max_byte_sse2;
 	}
-	len = strlen(s);
-	if (len == 0U) {
+#endif
+}
+
+// Part 1: the k = 2 case; banks shorter than two digits score 0.
+static u32
+best_bank(const char *s, size_t len)
+{
+	const u8 *u = (const u8 *)s;
+
+	if (s == NULL || len < 2U) {
 		return 0U;
 	}
-	// if the bank is < 12 digits, use all digits
-	if (len <= k) {
-		for (size_t i = 0U; i < len; i++) {
-			u8 d = (u8)(s[i] - '0');
-			val = val * 10U + (u64)d;
-		}
-		return val;
-	}
-	for (size_t picked = 0U; picked < k; picked++) {
-		size_t end = len - (k - picked); /* inclusive */
-		size_t best_pos = start;
-		char best_ch = '0';
-
-		for (size_t j = start; j <= end; j++) {
-			char ch = s[j];
-			if (ch > best_ch) {
-				best_ch = ch;
-				best_pos = j;
-				if (best_ch == '9') {
-				}
+
+	u8 tens = max_byte(u, len - 1U);
+	const u8 *at = memchr(u, tens, len - 1U);
+	u8 units = max_byte(at + 1, (size_t)(u + len - (at + 1)));
+	return (u32)(10U * (u32)(tens - '0') + (u32)(units - '0'));
+}
+
+// Best value for every pick count k = 1..kmax in one pass:
+// best[k] = max(best[k], best[k - 1] * 10 + d) for each digit d, walking k
+// downwards so every digit extends only subsequences that end before it.
+// For k > len the bank uses all its digits, as pick_digits does.  Only
+// kmax <= MAX_PICK, so every value fits in a u64.
+static void
+joltage_all(const char *s, size_t len, size_t kmax, u64 *best)
+{
+	assert(kmax <= MAX_PICK);
+	best[0] = 0U;
+	for (size_t k = 1U; k <= kmax; k++) {
+		best[k] = 0U;
+	}
+
+	for (size_t i = 0U; i < len; i++) {
+		u64 d = (u64)(s[i] - '0');
+		size_t top = (i + 1U < kmax) ? i + 1U : kmax;
+
+		for (size_t k = top; k > 0U; k--) {
+			u64 v = best[k - 1U] * 10U + d;
+			if (v > best[k]) {
+				best[k] = v;
 			}
 		}
-
-		val = val * 10U + (u64)(best_ch - '0');
-		start = best_pos + 1U;
 	}
 
-	return val;
+	for (size_t k = len + 1U; k <= kmax; k++) {
+		best[k] = best[len];
+	}
 }
-static u64
-part1(char banks[][MAX_WIDTH + 1U], size_t n)
+
+typedef struct {
+	size_t k;       // Part 2 pick count
+	size_t table_k; // 0, or the --table row count
+	u64 part1;
+	Dec part2;
+	Dec table[MAX_K + 1U];
+} Totals;
+
+// All per-bank work for one line, on a view into the read buffer.  The
+// kernels are not fused; each walks the line on its own: best_bank's two
+// max_byte scans, the Part 2 stack pass, then the --table DP pass.
+static void
+add_bank(Totals *t, const char *s, size_t len)
 {
-	u64 total = 0U;
-	for (size_t i = 0U; i < n; i++) {
-		u32 b = best_bank(banks[i]);
-		total += (u64)b;
+	t->part1 += best_bank(s, len);
+	add_joltage(&t->part2, s, len, t->k);
+
+	if (t->table_k > 0U) {
+		u64 best[MAX_PICK + 1U];
+		size_t fast = (t->table_k < MAX_PICK) ? t->table_k : MAX_PICK;
+
+		joltage_all(s, len, fast, best);
+		for (size_t k = 1U; k <= fast; k++) {
+			dec_add_u64(&t->table[k], best[k]);
+		}
+		// Rows past MAX_PICK take one stack pass each.
+		for (size_t k = MAX_PICK + 1U; k <= t->table_k; k++) {
+			add_joltage(&t->table[k], s, len, k);
+		}
 	}
-	return total;
 }
 
-static u64
-part2(char banks[][MAX_WIDTH + 1U], size_t n)
+// Scores every line of a chunk; the last line may lack its '\n'.
+typedef struct {
+	const char *s;
+	const char *e;
+	Totals t;
+} BankJob;
+
+static int
+scan_chunk(void *arg)
 {
-	u64 total = 0U;
-	for (size_t i = 0U; i < n; i++) {
-		u64 b = output_joltage(banks[i]);
-		total += b;
+	BankJob *job = arg;
+	const char *p = job->s;
+
+	while (p < job->e) {
+		const char *nl = memchr(p, '\n', (size_t)(job->e - p));
+		const char *e = (nl != NULL) ? nl : job->e;
+		const char *q = e;
+
+		while (q > p && q[-1] == '\r') {
+			q--;
+		}
+		for (const char *c = p; c < q; c++) {
+			if (!isspace((unsigned char)*c)) {
+				add_bank(&job->t, p, (size_t)(q - p));
+				break;
+			}
+		}
+		p = e + (nl != NULL);
 	}
-	return total;
+	return 0;
 }
 
-static size_t
-load_banks(char banks[][MAX_WIDTH + 1U], size_t cap)
+// Streams fp in rounds of nthreads * READ_CHUNK bytes and scores each line
+// where it lies in the buffer.  A round is cut at line boundaries into one
+// chunk per thread, and the per-chunk totals are added in input order.
+// Only an unfinished last line is moved to the front before the next read,
+// so memory is O(nthreads * READ_CHUNK + longest line) and there is no cap
+// on the number or width of banks.
+static void
+scan_banks(FILE *fp, int nthreads, Totals *t)
 {
-	char line[MAX_WIDTH + 4U];
-	size_t n = 0U;
+	static BankJob job[MAX_THREADS]; // Dec tables are too big for the stack
+	thrd_t tid[MAX_THREADS];
+	size_t cap = (size_t)nthreads * READ_CHUNK;
+	size_t have = 0U;
+	char *buf = xrealloc(NULL, cap);
+	bool eof = false;
 
-	if (banks == NULL || cap == 0U) {
-		return 0U;
-	}
-	while (read_line(stdin, line, sizeof line)) {
-		if (is_blank_line(line)) {
-			continue;
+	while (!eof) {
+		while (!eof && have < cap) {
+			size_t got = fread(buf + have, 1U, cap - have, fp);
+			eof = (got == 0U);
+			have += got;
 		}
-		if (n >= cap) {
-			fprintf(stderr, "too many banks (cap=%d)\n", MAX_BANKS);
-			exit(EXIT_FAILURE);
+
+		// Whole lines only, unless this is the tail of the input.
+		size_t whole = have;
+		if (!eof) {
+			while (whole > 0U && buf[whole - 1U] != '\n') {
+				whole--;
+			}
+			if (whole == 0U) {
+				cap *= 2U; // one line longer than the buffer
+				buf = xrealloc(buf, cap);
+				continue;
+			}
 		}
-		size_t len = strlen(line);
-		if (len > MAX_WIDTH) {
-			fprintf(stderr, "bank line too long (%zu > %d)\n", len,
-			    MAX_WIDTH);
-			exit(EXIT_FAILURE);
+
+		const char *p = buf;
+		const char *end = buf + whole;
+		for (int i = 0; i < nthreads; i++) {
+			const char *e = end;
+			if (i < nthreads - 1) {
+				const char *cut = buf + whole * (size_t)(i + 1) /
+				    (size_t)nthreads;
+				const char *nl = NULL;
+				if (cut > p) {
+					nl = memchr(cut - 1, '\n',
+					    (size_t)(end - cut + 1));
+				}
+				e = (cut <= p) ? p : (nl != NULL) ? nl + 1 : end;
+			}
+			job[i] = (BankJob){
+				.s = p,
+				.e = e,
+				.t = { .k = t->k, .table_k = t->table_k },
+			};
+			p = e;
+		}
+
+		for (int i = 1; i < nthreads; i++) {
+			if (thrd_create(&tid[i], scan_chunk, &job[i]) !=
+			    thrd_success) {
+				fprintf(stderr, "thrd_create failed\n");
+				exit(EXIT_FAILURE);
+			}
+		}
+		scan_chunk(&job[0]);
+		for (int i = 1; i < nthreads; i++) {
+			thrd_join(tid[i], NULL);
+		}
+
+		for (int i = 0; i < nthreads; i++) {
+			t->part1 += job[i].t.part1;
+			dec_add(&t->part2, &job[i].t.part2);
+			for (size_t k = 1U; k <= t->table_k; k++) {
+				dec_add(&t->table[k], &job[i].t.table[k]);
+			}
 		}
-		memcpy(banks[n], line, len + 1U);
-		n++;
+
+		have -= whole;
+		memmove(buf, buf + whole, have);
+	}
+
+	if (ferror(fp)) {
+		fprintf(stderr, "read error\n");
+		exit(EXIT_FAILURE);
 	}
-	return n;
+	free(buf);
 }
 
 int
-main(void)
-{
-	static char banks[MAX_BANKS][MAX_WIDTH + 1U];
-	size_t bank_count;
-	u64 part_1;
-	u64 part_2;
-	u64 sample_1;
-	u64 sample_2;
-
-	sample_1 = part1(sample_banks, SAMPLE_BANK_COUNT);
-	sample_2 = part2(sample_banks, SAMPLE_BANK_COUNT);
-	printf("Part1 sample: %" PRIu64 "\n", sample_1);
-	printf("Part1 sample: %" PRIu64 "\n", sample_2);
-
-	bank_count = load_banks(banks, MAX_BANKS);
-	part_1 = part1(banks, bank_count);
-	part_2 = part2(banks, bank_count);
-	printf("Part1: %" PRIu64 "\n", part_1);
-	printf("Part2: %" PRIu64 "\n", part_2);
+main(int argc, char **argv)
+{
+	size_t k = 12U;
+	size_t table_k = 0U;
+	int nthreads = 1;
+
+	for (int i = 1; i < argc; i++) {
+		bool is_k = strcmp(argv[i], "-k") == 0;
+		bool is_table = strcmp(argv[i], "--table") == 0;
+		bool is_threads = strcmp(argv[i], "--threads") == 0;
+		char *end = NULL;
+		long v = 0;
+
+		if ((!is_k && !is_table && !is_threads) || i + 1 >= argc) {
+			fprintf(stderr, "usage: %s [-k digits] [--table kmax] "
+			    "[--threads N]\n", argv[0]);
+			return EXIT_FAILURE;
+		}
+		v = strtol(argv[++i], &end, 10);
+		if (is_threads) {
+			if (*end != '\0' || v < 1 || v > MAX_THREADS) {
+				fprintf(stderr, "--threads must be 1..%d\n",
+				    MAX_THREADS);
+				return EXIT_FAILURE;
+			}
+			nthreads = (int)v;
+			continue;
+		}
+		if (*end != '\0' || v < 1 || v > MAX_K) {
+			fprintf(stderr, "k must be 1..%d\n", MAX_K);
+			return EXIT_FAILURE;
+		}
+		if (is_k) {
+			k = (size_t)v;
+		} else {
+			table_k = (size_t)v;
+		}
+	}
+
+	select_kernels();
+
+	Totals sample = { .k = k };
+	for (size_t i = 0U; i < SAMPLE_BANK_COUNT; i++) {
+		add_bank(&sample, sample_banks[i], strlen(sample_banks[i]));
+	}
+	printf("Part1 sample: %" PRIu64 "\n", sample.part1);
+	dec_print("Part1 sample: ", &sample.part2);
+
+	Totals input = { .k = k, .table_k = table_k };
+	scan_banks(stdin, nthreads, &input);
+	printf("Part1: %" PRIu64 "\n", input.part1);
+	dec_print("Part2: ", &input.part2);
+
+	if (table_k > 0U) {
+		printf("k\ttotal\n");
+		for (size_t j = 1U; j <= table_k; j++) {
+			char label[32];
+
+			snprintf(label, sizeof label, "%zu\t", j);
+			dec_print(label, &input.table[j]);
+		}
+	}
 	return EXIT_SUCCESS;
 }
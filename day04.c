@@ -1,7 +1,11 @@
 #include "aoc.h"
 #include <inttypes.h>
+#include <limits.h>
 #include <stdio.h>
 #include <string.h>
+#include <threads.h>
+
+#define MAX_THREADS 256
 
 static const char *sample_rows[] = {
     "..@@.@@@@.",
@@ -16,187 +20,813 @@ static const char *sample_rows[] = {
     "@.@.@@@.@."
 };
 
+// Roll map with one bit per cell.  Rows are padded to whole words, and a
+// clear halo row above and below lets every row be read with both of its
+// vertical neighbours.
+typedef struct {
+    int     h;
+    int     w;
+    int     words; // u64 words per row
+    AocBits bits;  // row r is words [(r + 1) * words, (r + 2) * words)
+} RollBits;
+
+static u64 *
+rolls_row(const RollBits *rb, int r)
+{
+    return rb->bits.w + (size_t)(r + 1) * (size_t)rb->words;
+}
+
+// Bits for h rows of w columns plus the halo rows, failing loudly when
+// the count does not fit the int sizes AocBits uses.
 static void
-fill_sample(AocGrid *g)
+rolls_init(RollBits *rb, int h, int w)
 {
-    int H = (int)(sizeof sample_rows / sizeof sample_rows[0]);
-    int W = (int)strlen(sample_rows[0]);
+    rb->h     = h;
+    rb->w     = w;
+    rb->words = bits_nwords(w > 0 ? w : 1);
+    if ((long long)(h + 2) * rb->words * 64 > INT_MAX) {
+        fprintf(stderr, "Roll map too large (%d x %d)\n", h, w);
+        exit(EXIT_FAILURE);
+    }
+    bits_init(&rb->bits, (h + 2) * rb->words * 64);
+}
 
-    g->h = H;
-    g->w = W;
+// Re-lays rb out for cap rows of words words each, keeping its rows.
+static void
+rolls_reshape(RollBits *rb, int cap, int words)
+{
+    RollBits nb;
 
-    for (int r = 0; r < H; r++) {
-        const char *src = sample_rows[r];
-        int len = (int)strlen(src);
-        if (len != W) {
-            fprintf(stderr, "sample row width mismatch\n");
-            exit(EXIT_FAILURE);
+    rolls_init(&nb, cap, words * 64);
+    for (int r = 0; r < rb->h; r++) {
+        memcpy(rolls_row(&nb, r), rolls_row(rb, r),
+               (size_t)(words < rb->words ? words : rb->words) * sizeof(u64));
+    }
+    bits_free(&rb->bits);
+    rb->bits  = nb.bits;
+    rb->words = nb.words;
+}
+
+// Appends the '@' cells of s[0..len) as row rb->h, growing the row count
+// and the row width geometrically.  *cap is the number of rows allocated.
+static void
+rolls_push_row(RollBits *rb, int *cap, const char *s, size_t len)
+{
+    if (len > (size_t)INT_MAX - 64U) {
+        fprintf(stderr, "Roll map row too wide\n");
+        exit(EXIT_FAILURE);
+    }
+    int need  = bits_nwords((int)len);
+    int words = rb->words;
+    if (need > words || rb->h == *cap) {
+        if (need > words) {
+            words = (need > 2 * words) ? need : 2 * words;
         }
-        for (int c = 0; c < W; c++) {
-            g->cells[r][c] = src[c];
+        if (rb->h == *cap) {
+            *cap *= 2;
         }
+        rolls_reshape(rb, *cap, words);
     }
+
+    u64 *row = rolls_row(rb, rb->h);
+    for (size_t c = 0U; c < len; c++) {
+        if (s[c] == '@') {
+            row[c >> 6] |= (u64)1 << (c & 63U);
+        }
+    }
+    if ((int)len > rb->w) {
+        rb->w = (int)len;
+    }
+    rb->h++;
 }
 
-static u32
-count_access(const AocGrid *rolls)
+// Drops the spare rows and words left by rolls_push_row.
+static void
+rolls_trim(RollBits *rb)
+{
+    rolls_reshape(rb, rb->h, bits_nwords(rb->w > 0 ? rb->w : 1));
+}
+
+static void
+rolls_from_rows(RollBits *rb, const char *const *rows, int n)
+{
+    int cap = n > 0 ? n : 1;
+
+    rolls_init(rb, cap, 0);
+    rb->h = 0;
+    for (int r = 0; r < n; r++) {
+        rolls_push_row(rb, &cap, rows[r], strlen(rows[r]));
+    }
+    rolls_trim(rb);
+}
+
+// Reads a roll map from fp with getline, ending at EOF or a blank line and
+// ignoring trailing whitespace, as grid_load does, but with no row or
+// column cap.  Returns false (and leaves rb empty) for a terminal or an
+// empty map.
+static bool
+rolls_load(RollBits *rb, FILE *fp)
+{
+    char   *line = NULL;
+    size_t  lcap = 0U;
+    ssize_t len;
+    int     cap  = 64;
+
+    if (fp == stdin && isatty(fileno(fp))) {
+        return false;
+    }
+
+    rolls_init(rb, cap, 0);
+    rb->h = 0;
+    while ((len = getline(&line, &lcap, fp)) >= 0 && !is_blank_line(line)) {
+        while (len > 0 && isspace((unsigned char)line[len - 1])) {
+            len--;
+        }
+        rolls_push_row(rb, &cap, line, (size_t)len);
+    }
+    free(line);
+
+    if (rb->h == 0) {
+        bits_free(&rb->bits);
+        return false;
+    }
+    rolls_trim(rb);
+    return true;
+}
+
+// Word j of a row shifted one column east or west, carrying the edge bit
+// across from the adjacent word.
+static inline u64
+from_west(const u64 *row, int j)
+{
+    return (row[j] << 1) | (j > 0 ? row[j - 1] >> 63 : 0U);
+}
+
+static inline u64
+from_east(const u64 *row, int j, int n)
+{
+    return (row[j] >> 1) | (j + 1 < n ? row[j + 1] << 63 : 0U);
+}
+
+static inline u64
+full_add(u64 a, u64 b, u64 c, u64 *carry)
+{
+    u64 t = a ^ b;
+
+    *carry = (a & b) | (t & c);
+    return t ^ c;
+}
+
+// Cells in word j of row mid (n words per row) with fewer than four rolls
+// among their eight neighbours, 64 at a time.  The neighbour bits go
+// through a carry-save adder tree; a count is below four exactly when
+// nothing carries into the fours plane.
+static inline u64
+sparse_mask(const u64 *up, const u64 *mid, const u64 *dn, int j, int n)
 {
-    static const int dr[8] = { -1, -1, -1,  0, 0, 1, 1, 1 };
-    static const int dc[8] = { -1,  0,  1, -1, 1,-1, 0, 1 };
+    u64 ca, cb, cc, cd, ce;
+    u64 sa = full_add(from_west(up, j), up[j], from_east(up, j, n), &ca);
+    u64 sb = full_add(from_west(dn, j), dn[j], from_east(dn, j, n), &cb);
+    u64 w  = from_west(mid, j);
+    u64 e  = from_east(mid, j, n);
+    u64 sc = w ^ e;
+
+    cc = w & e;
+    (void)full_add(sa, sb, sc, &cd);        // ones plane, carries into twos
+    u64 se = full_add(ca, cb, cc, &ce);     // twos plane, carries into fours
+    return ~(ce | (se & cd));
+}
 
+static u32
+count_access(const RollBits *rb)
+{
     u32 free = 0U;
 
-    for (int r = 0; r < rolls->h; r++) {
-        for (int c = 0; c < rolls->w; c++) {
-            if (rolls->cells[r][c] != '@') {
-                continue;
+    for (int r = 0; r < rb->h; r++) {
+        const u64 *up  = rolls_row(rb, r - 1);
+        const u64 *mid = rolls_row(rb, r);
+        const u64 *dn  = rolls_row(rb, r + 1);
+
+        for (int j = 0; j < rb->words; j++) {
+            u64 m = mid[j] & sparse_mask(up, mid, dn, j, rb->words);
+            free += (u32)__builtin_popcountll(m);
+        }
+    }
+
+    return free;
+}
+
+// Part 1 over a stream of rows in O(width) memory.  Row k lives in ring
+// slot k % 3, so while row k + 1 is read in, rows k - 1 and k are still
+// there; row -1 and the row after the last are clear.  The input ends at
+// EOF or a blank line, as in grid_load, but rows and width are unbounded.
+static u64
+stream_access(FILE *fp)
+{
+    u64    *ring[3] = { NULL, NULL, NULL };
+    int     words   = 0;
+    char   *line    = NULL;
+    size_t  lcap    = 0U;
+    u64     count   = 0U;
+
+    for (long k = 0;; k++) {
+        ssize_t len  = getline(&line, &lcap, fp);
+        bool    done = (len < 0 || is_blank_line(line));
+
+        while (!done && len > 0 && isspace((unsigned char)line[len - 1])) {
+            len--;
+        }
+        int need = done ? 0 : bits_nwords((int)len);
+        if (need > words) {
+            for (int i = 0; i < 3; i++) {
+                ring[i] = xrealloc(ring[i], (size_t)need * sizeof(u64));
+                memset(ring[i] + words, 0,
+                       (size_t)(need - words) * sizeof(u64));
             }
+            words = need;
+        }
 
-            int adj = 0;
-
-            for (int k = 0; k < 8; k++) {
-                int nr = r + dr[k];
-                int nc = c + dc[k];
-                if (!grid_in_bounds(rolls, nr, nc)) {
-                    continue;
-                }
-                if (rolls->cells[nr][nc] == '@') {
-                    adj++;
-                }
+        u64 *row = ring[k % 3];
+        if (words > 0) {
+            memset(row, 0, (size_t)words * sizeof(u64));
+        }
+        for (ssize_t c = 0; !done && c < len; c++) {
+            if (line[c] == '@') {
+                row[c >> 6] |= (u64)1 << (c & 63);
             }
+        }
 
-            if (adj < 4) {
-                free++;
+        if (k > 0) {
+            const u64 *up  = ring[(k + 1) % 3]; // row k - 2
+            const u64 *mid = ring[(k + 2) % 3]; // row k - 1
+            for (int j = 0; j < words; j++) {
+                u64 m = mid[j] & sparse_mask(up, mid, row, j, words);
+                count += (u64)__builtin_popcountll(m);
             }
         }
+        if (done) {
+            break;
+        }
     }
 
-    return free;
+    free(line);
+    for (int i = 0; i < 3; i++) {
+        free(ring[i]);
+    }
+    return count;
 }
 
-static u32
-count_removed(const AocGrid *rolls)
+// Simple reusable barrier; C11 threads has none.
+typedef struct {
+    mtx_t    m;
+    cnd_t    c;
+    int      n;
+    int      waiting;
+    unsigned gen;
+} Barrier;
+
+static void
+barrier_wait(Barrier *b)
 {
-    static const int dr[8] = { -1, -1, -1,  0, 0, 1, 1, 1 };
-    static const int dc[8] = { -1,  0,  1, -1, 1,-1, 0, 1 };
+    mtx_lock(&b->m);
+    unsigned gen = b->gen;
+    if (++b->waiting == b->n) {
+        b->waiting = 0;
+        b->gen++;
+        cnd_broadcast(&b->c);
+    } else {
+        while (gen == b->gen) {
+            cnd_wait(&b->c, &b->m);
+        }
+    }
+    mtx_unlock(&b->m);
+}
 
-    int H = rolls->h;
-    int W = rolls->w;
+typedef struct Peel Peel;
 
-    static int  adj[AOC_MAX_H][AOC_MAX_W];
-    static char gone[AOC_MAX_H][AOC_MAX_W];
+// One horizontal stripe of rows [lo, hi), owned by one thread.  Row indices
+// in dirty and changed are relative to lo.
+typedef struct {
+    Peel   *peel;
+    int     index;
+    int     lo;
+    int     hi;
+    AocBits dirty;   // rows to re-examine this round
+    AocBits changed; // rows that lost rolls this round
+    bool    in_top;  // inbox: the stripe above removed from its last row
+    bool    in_bot;  // inbox: the stripe below removed from its first row
+    u32     count;   // removals this round
+} PeelStripe;
 
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            adj[r][c]  = 0;
-            gone[r][c] = 0;
+struct Peel {
+    RollBits   *rb;
+    RollBits    rm; // rolls leaving this round
+    Barrier     bar;
+    PeelStripe *stripe;
+    int         nstripes;
+    bool        record;
+    u32        *per;
+    int         nround;
+    u32         removed;
+};
+
+// Runs the peel rounds for one stripe.  Each round has two phases split by
+// barriers: mark the leaving rolls of every dirty row from the shared map,
+// which nobody writes meanwhile, then clear them from the stripe's own rows.
+// A removal in an edge row goes to the neighbour stripe's inbox so it looks
+// at its facing row next round.  The peel ends after a round in which no
+// stripe removed anything.
+static int
+peel_stripe(void *arg)
+{
+    PeelStripe *s    = arg;
+    Peel       *p    = s->peel;
+    RollBits   *rb   = p->rb;
+    int         n    = rb->words;
+    int         rows = s->hi - s->lo;
+
+    for (;;) {
+        if (s->in_top) {
+            bits_set(&s->dirty, 0);
         }
-    }
+        if (s->in_bot) {
+            bits_set(&s->dirty, rows - 1);
+        }
+        s->in_top = false;
+        s->in_bot = false;
 
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            if (rolls->cells[r][c] != '@') {
-                continue;
+        bits_clear(&s->changed);
+        for (int i = bits_first(&s->dirty); i >= 0;
+             i = bits_next(&s->dirty, i)) {
+            int        r   = s->lo + i;
+            const u64 *up  = rolls_row(rb, r - 1);
+            const u64 *mid = rolls_row(rb, r);
+            const u64 *dn  = rolls_row(rb, r + 1);
+            u64       *out = rolls_row(&p->rm, r);
+            u64        any = 0U;
+
+            for (int j = 0; j < n; j++) {
+                out[j] = mid[j] & sparse_mask(up, mid, dn, j, n);
+                any |= out[j];
             }
-            int count = 0;
-            for (int k = 0; k < 8; k++) {
-                int nr = r + dr[k];
-                int nc = c + dc[k];
-                if (!grid_in_bounds(rolls, nr, nc)) {
-                    continue;
-                }
-                if (rolls->cells[nr][nc] == '@') {
-                    count++;
-                }
+            if (any != 0U) {
+                bits_set(&s->changed, i);
             }
-            adj[r][c] = count;
         }
-    }
+        barrier_wait(&p->bar);
 
-    static int qr[AOC_MAX_H * AOC_MAX_W];
-    static int qc[AOC_MAX_H * AOC_MAX_W];
-    int head = 0;
-    int tail = 0;
+        bits_clear(&s->dirty);
+        s->count = 0U;
+        for (int i = bits_first(&s->changed); i >= 0;
+             i = bits_next(&s->changed, i)) {
+            u64       *mid = rolls_row(rb, s->lo + i);
+            const u64 *out = rolls_row(&p->rm, s->lo + i);
 
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            if (rolls->cells[r][c] != '@') {
-                continue;
+            s->count += (u32)bitw_popcount(out, n);
+            bitw_andnot(mid, out, n);
+            bits_set_range(&s->dirty, i > 0 ? i - 1 : 0,
+                           i + 2 < rows ? i + 2 : rows);
+            if (i == 0 && s->index > 0) {
+                p->stripe[s->index - 1].in_bot = true;
             }
-            if (adj[r][c] < 4) {
-                qr[tail] = r;
-                qc[tail] = c;
-                tail++;
+            if (i == rows - 1 && s->index + 1 < p->nstripes) {
+                p->stripe[s->index + 1].in_top = true;
+            }
+        }
+        barrier_wait(&p->bar);
+
+        u32 total = 0U;
+        for (int t = 0; t < p->nstripes; t++) {
+            total += p->stripe[t].count;
+        }
+        if (total == 0U) {
+            return 0;
+        }
+        if (s->index == 0) {
+            p->removed += total;
+            if (p->record) {
+                p->per = xrealloc(p->per,
+                                  ((size_t)p->nround + 1U) * sizeof *p->per);
+                p->per[p->nround] = total;
             }
+            p->nround++;
         }
     }
+}
+
+// Part 2: peels rb in place, one round at a time.  Each round removes every
+// roll that has fewer than four neighbours at the start of the round, so a
+// round is a whole-frontier bit operation and no cell is queued twice.
+// Rounds only revisit rows within one of a row that lost rolls in the
+// previous round.  The surviving rolls are the same 4-core a one-at-a-time
+// peel would reach, and the rounds do not depend on how the rows are split
+// into stripes, so every thread count gives the same result.  If rounds is
+// not NULL it receives a malloc'd array of per-round removal counts, and
+// *nrounds its length.
+static u32
+count_removed(RollBits *rb, int nthreads, u32 **rounds, int *nrounds)
+{
+    Peel   p   = { .rb = rb, .record = (rounds != NULL) };
+    thrd_t tid[MAX_THREADS];
 
-    u32 removed = 0U;
+    if (nthreads > rb->h) {
+        nthreads = rb->h > 0 ? rb->h : 1;
+    }
+    p.nstripes = nthreads;
+    p.stripe   = calloc((size_t)nthreads, sizeof *p.stripe);
+    if (p.stripe == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
+    rolls_init(&p.rm, rb->h, rb->w);
+    p.bar.n = nthreads;
+    if (mtx_init(&p.bar.m, mtx_plain) != thrd_success ||
+        cnd_init(&p.bar.c) != thrd_success) {
+        fprintf(stderr, "mtx_init/cnd_init failed\n");
+        exit(EXIT_FAILURE);
+    }
 
-    while (head < tail) {
-        int r = qr[head];
-        int c = qc[head];
-        head++;
+    for (int t = 0; t < nthreads; t++) {
+        PeelStripe *s = &p.stripe[t];
+        s->peel  = &p;
+        s->index = t;
+        s->lo    = (int)((long)rb->h * t / nthreads);
+        s->hi    = (int)((long)rb->h * (t + 1) / nthreads);
+        bits_init(&s->dirty, s->hi - s->lo);
+        bits_init(&s->changed, s->hi - s->lo);
+        bits_set_range(&s->dirty, 0, s->hi - s->lo);
+    }
 
-        if (gone[r][c]) {
-            continue;
+    for (int t = 1; t < nthreads; t++) {
+        if (thrd_create(&tid[t], peel_stripe, &p.stripe[t]) !=
+            thrd_success) {
+            fprintf(stderr, "thrd_create failed\n");
+            exit(EXIT_FAILURE);
         }
-        if (rolls->cells[r][c] != '@') {
+    }
+    peel_stripe(&p.stripe[0]);
+    for (int t = 1; t < nthreads; t++) {
+        thrd_join(tid[t], NULL);
+    }
+
+    for (int t = 0; t < nthreads; t++) {
+        bits_free(&p.stripe[t].changed);
+        bits_free(&p.stripe[t].dirty);
+    }
+    cnd_destroy(&p.bar.c);
+    mtx_destroy(&p.bar.m);
+    bits_free(&p.rm.bits);
+    free(p.stripe);
+    if (rounds != NULL) {
+        *rounds  = p.per;
+        *nrounds = p.nround;
+    }
+    return p.removed;
+}
+
+// Roll map kept up to date under single-cell edits for --edits.  Every
+// cell tracks how many of its eight neighbours hold a roll (nb) and how
+// many hold a core roll (cdeg), where the core is the set of rolls that
+// survive a full peel: the largest set in which every roll has four or more
+// neighbours in the set.  Part 1 is then a counter and Part 2 is
+// rolls - core_n.
+typedef struct {
+    int  h;
+    int  w;
+    u8  *roll;
+    u8  *core;
+    u8  *nb;
+    u8  *cdeg;
+    u32 *seen;  // cell joined the current candidate search when == epoch
+    u32  epoch;
+    int *queue;
+    int *list;
+    u32  rolls;
+    u32  access; // rolls with nb < 4
+    u32  core_n;
+} RollMap;
+
+static const int nb_dr[8] = { -1, -1, -1,  0, 0, 1, 1, 1 };
+static const int nb_dc[8] = { -1,  0,  1, -1, 1,-1, 0, 1 };
+
+// Calls body with j set to each in-bounds neighbour of cell i.
+#define FOR_NEIGHBOURS(m, i, j, body)                                      \
+    do {                                                                   \
+        int r_ = (i) / (m)->w;                                             \
+        int c_ = (i) % (m)->w;                                             \
+        for (int k_ = 0; k_ < 8; k_++) {                                   \
+            int nr_ = r_ + nb_dr[k_];                                      \
+            int nc_ = c_ + nb_dc[k_];                                      \
+            if (nr_ < 0 || nr_ >= (m)->h || nc_ < 0 || nc_ >= (m)->w) {    \
+                continue;                                                  \
+            }                                                              \
+            int j = nr_ * (m)->w + nc_;                                    \
+            body                                                           \
+        }                                                                  \
+    } while (0)
+
+static void
+core_set(RollMap *m, int i, bool in)
+{
+    m->core[i] = in;
+    if (in) {
+        m->core_n++;
+        FOR_NEIGHBOURS(m, i, j, { m->cdeg[j]++; });
+    } else {
+        m->core_n--;
+        FOR_NEIGHBOURS(m, i, j, { m->cdeg[j]--; });
+    }
+}
+
+// Drops queued core rolls whose core degree is below four, then any core
+// roll that falls below four as a result.  A roll is queued when it falls
+// from four to three, which happens at most once per peel, so the queue
+// never needs more than one slot per cell.
+static void
+core_peel(RollMap *m, int tail)
+{
+    for (int head = 0; head < tail; head++) {
+        int i = m->queue[head];
+        if (!m->core[i] || m->cdeg[i] >= 4) {
             continue;
         }
+        core_set(m, i, false);
+        FOR_NEIGHBOURS(m, i, j, {
+            if (m->core[j] && m->cdeg[j] == 3) {
+                m->queue[tail++] = j;
+            }
+        });
+    }
+}
 
-        gone[r][c] = 1;
-        removed++;
+static void
+rollmap_init(RollMap *m, const RollBits *rb)
+{
+    size_t n = (size_t)rb->h * (size_t)rb->w;
 
-        for (int k = 0; k < 8; k++) {
-            int nr = r + dr[k];
-            int nc = c + dc[k];
+    if (n > (size_t)INT_MAX) {
+        fprintf(stderr, "Roll map too large for --edits (%d x %d)\n",
+                rb->h, rb->w);
+        exit(EXIT_FAILURE);
+    }
+    *m = (RollMap){ .h = rb->h, .w = rb->w };
+    m->roll  = calloc(n, 1U);
+    m->core  = calloc(n, 1U);
+    m->nb    = calloc(n, 1U);
+    m->cdeg  = calloc(n, 1U);
+    m->seen  = calloc(n, sizeof *m->seen);
+    m->queue = malloc(n * sizeof *m->queue);
+    m->list  = malloc(n * sizeof *m->list);
+    if (m->roll == NULL || m->core == NULL || m->nb == NULL ||
+        m->cdeg == NULL || m->seen == NULL || m->queue == NULL ||
+        m->list == NULL) {
+        fprintf(stderr, "Out of memory\n");
+        exit(EXIT_FAILURE);
+    }
 
-            if (!grid_in_bounds(rolls, nr, nc)) {
-                continue;
-            }
-            if (rolls->cells[nr][nc] != '@') {
-                continue;
-            }
-            if (gone[nr][nc]) {
-                continue;
+    for (int i = 0; i < (int)n; i++) {
+        int r = i / rb->w;
+        int c = i % rb->w;
+        if ((rolls_row(rb, r)[c >> 6] >> (c & 63)) & 1U) {
+            m->roll[i] = 1;
+            m->rolls++;
+            FOR_NEIGHBOURS(m, i, j, { m->nb[j]++; });
+        }
+    }
+
+    // Start from every roll in the core and peel.
+    int tail = 0;
+    for (int i = 0; i < (int)n; i++) {
+        m->cdeg[i] = m->nb[i];
+        if (m->roll[i]) {
+            m->access += (m->nb[i] < 4);
+            m->core[i] = 1;
+            m->core_n++;
+            if (m->cdeg[i] < 4) {
+                m->queue[tail++] = i;
             }
+        }
+    }
+    core_peel(m, tail);
+}
+
+static void
+rollmap_free(RollMap *m)
+{
+    free(m->list);
+    free(m->queue);
+    free(m->seen);
+    free(m->cdeg);
+    free(m->nb);
+    free(m->core);
+    free(m->roll);
+}
+
+// Removing a roll can only shrink the core, and only through rolls that
+// drop from four core neighbours to three.
+static void
+rollmap_remove(RollMap *m, int i)
+{
+    if (!m->roll[i]) {
+        return;
+    }
+    m->roll[i] = 0;
+    m->rolls--;
+    m->access -= (m->nb[i] < 4);
+    FOR_NEIGHBOURS(m, i, j, {
+        m->nb[j]--;
+        m->access += (m->roll[j] && m->nb[j] == 3);
+    });
 
-            if (adj[nr][nc] > 0) {
-                adj[nr][nc]--;
+    if (m->core[i]) {
+        int tail = 0;
+        core_set(m, i, false);
+        FOR_NEIGHBOURS(m, i, j, {
+            if (m->core[j] && m->cdeg[j] == 3) {
+                m->queue[tail++] = j;
             }
+        });
+        core_peel(m, tail);
+    }
+}
+
+// Placing a roll can only grow the core, and every roll that joins is
+// linked to the new one through non-core rolls: a non-core group not
+// touching it would already have had four core-or-group neighbours per
+// roll.  So the candidates are the non-core rolls reachable from the new
+// roll; they join the core together and the peel drops the ones that
+// cannot stay.
+static void
+rollmap_place(RollMap *m, int i)
+{
+    if (m->roll[i]) {
+        return;
+    }
+    m->roll[i] = 1;
+    m->rolls++;
+    m->access += (m->nb[i] < 4);
+    FOR_NEIGHBOURS(m, i, j, {
+        m->nb[j]++;
+        m->access -= (m->roll[j] && m->nb[j] == 4);
+    });
 
-            if (adj[nr][nc] < 4) {
-                qr[tail] = nr;
-                qc[tail] = nc;
-                tail++;
+    int n = 0;
+    m->epoch++;
+    m->seen[i] = m->epoch;
+    m->list[n++] = i;
+    for (int head = 0; head < n; head++) {
+        FOR_NEIGHBOURS(m, m->list[head], j, {
+            if (m->roll[j] && !m->core[j] && m->seen[j] != m->epoch) {
+                m->seen[j] = m->epoch;
+                m->list[n++] = j;
             }
+        });
+    }
+
+    for (int k = 0; k < n; k++) {
+        core_set(m, m->list[k], true);
+    }
+    int tail = 0;
+    for (int k = 0; k < n; k++) {
+        if (m->cdeg[m->list[k]] < 4) {
+            m->queue[tail++] = m->list[k];
         }
     }
+    core_peel(m, tail);
+}
+
+// Reads "+ r c" (place) and "- r c" (remove) edits from fp, with batches
+// separated by blank lines, and prints both parts after each batch.
+static void
+run_edits(RollMap *m, FILE *fp)
+{
+    char  *line    = NULL;
+    size_t lcap    = 0U;
+    int    batch   = 0;
+    int    pending = 0;
+    long   lineno  = 0;
+
+    printf("batch\tpart1\tpart2\n");
+    for (;;) {
+        bool eof = (getline(&line, &lcap, fp) < 0);
+
+        lineno++;
+        if (eof || is_blank_line(line)) {
+            if (pending > 0) {
+                printf("%d\t%u\t%u\n", ++batch, m->access,
+                       m->rolls - m->core_n);
+                pending = 0;
+            }
+            if (eof) {
+                break;
+            }
+            continue;
+        }
 
-    return removed;
+        char op   = 0;
+        int  r    = 0;
+        int  c    = 0;
+        int  used = 0;
+        if (sscanf(line, " %c %d %d %n", &op, &r, &c, &used) != 3 ||
+            line[used] != '\0' || (op != '+' && op != '-')) {
+            fprintf(stderr, "bad edit at edit line %ld: %s", lineno, line);
+            exit(EXIT_FAILURE);
+        }
+        if (r < 0 || r >= m->h || c < 0 || c >= m->w) {
+            fprintf(stderr, "edit line %ld is outside the %d x %d map: "
+                    "%s", lineno, m->h, m->w, line);
+            exit(EXIT_FAILURE);
+        }
+        if (op == '+') {
+            rollmap_place(m, r * m->w + c);
+        } else {
+            rollmap_remove(m, r * m->w + c);
+        }
+        pending++;
+    }
+    free(line);
 }
 
 int
-main(void)
+main(int argc, char **argv)
 {
-  AocGrid rolls;
+  RollBits bits;
+  RollMap map;
   u32 part1;
   u32 part2;
+  bool show_rounds = false;
+  bool stream = false;
+  bool edits = false;
+  int nthreads = 1;
+  u32 *rounds = NULL;
+  int nrounds = 0;
+
+  for (int i = 1; i < argc; i++) {
+    if (strcmp(argv[i], "--rounds") == 0) {
+      show_rounds = true;
+    } else if (strcmp(argv[i], "--stream") == 0) {
+      stream = true;
+    } else if (strcmp(argv[i], "--edits") == 0) {
+      edits = true;
+    } else if (strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+      char *end = NULL;
+      long v = strtol(argv[++i], &end, 10);
+      if (*end != '\0' || v < 1 || v > MAX_THREADS) {
+        fprintf(stderr, "--threads must be 1..%d\n", MAX_THREADS);
+        return EXIT_FAILURE;
+      }
+      nthreads = (int)v;
+    } else {
+      fprintf(stderr, "usage: %s [--stream | --edits | "
+              "[--rounds] [--threads N]]\n", argv[0]);
+      return EXIT_FAILURE;
+    }
+  }
+
+  // Part 1 only; Part 2 needs the whole grid.
+  if (stream) {
+    printf("Part1 sample: %" PRIu64 "\n", stream_access(stdin));
+    return EXIT_SUCCESS;
+  }
+
+  bool have_input = rolls_load(&bits, stdin);
+  if (!have_input) {
+    rolls_from_rows(&bits, sample_rows,
+                    (int)(sizeof sample_rows / sizeof sample_rows[0]));
+  }
+
+  // count_removed peels the map, so the edit engine is seeded first.
+  if (edits && have_input) {
+    rollmap_init(&map, &bits);
+  }
 
-  bool have_input = grid_load(&rolls, stdin);
   if (have_input) {
-    part1 = count_access(&rolls);
-    part2 = count_removed(&rolls);
+    part1 = count_access(&bits);
+    part2 = count_removed(&bits, nthreads,
+                          show_rounds ? &rounds : NULL, &nrounds);
     printf("Part1 sample: %u\n", part1);
     printf("Part2 sample: %u\n", part2);
   } else {
-    fill_sample(&rolls);
-    part1 = count_access(&rolls);
-    part2 = count_removed(&rolls);
+    part1 = count_access(&bits);
+    part2 = count_removed(&bits, nthreads,
+                          show_rounds ? &rounds : NULL, &nrounds);
     printf("Part1: %u\n", part1);
     printf("Part2: %u\n", part2);
   }
+
+  // The grid ends at its blank line; edit batches follow on stdin.
+  if (edits && have_input) {
+    run_edits(&map, stdin);
+    rollmap_free(&map);
+  }
+
+  if (show_rounds) {
+    printf("round\tremoved\n");
+    for (int i = 0; i < nrounds; i++) {
+      printf("%d\t%u\n", i + 1, rounds[i]);
+    }
+    free(rounds);
+  }
+  bits_free(&bits.bits);
   return EXIT_SUCCESS;
 }
-
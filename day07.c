@@ -117,11 +117,15 @@ count_splits(const AocGrid *g)
 
 // Part 2
 
-static bool dp_seen[AOC_MAX_H][AOC_MAX_W];
-static u64  dp_val[AOC_MAX_H][AOC_MAX_W];
+// Memo keyed by (r << 32 | c); holds only the states the beam reaches.
+static inline u64
+cell_key(int r, int c)
+{
+    return ((u64)(u32)r << 32) | (u64)(u32)c;
+}
 
 static u64
-paths_from(const AocGrid *g, int r, int c)
+paths_from(const AocGrid *g, AocMap *memo, int r, int c)
 {
     int H = g->h;
     int W = g->w;
@@ -133,8 +137,11 @@ paths_from(const AocGrid *g, int r, int c)
         return 1U;
     }
 
-    if (dp_seen[r][c]) {
-        return dp_val[r][c];
+    u64 key = cell_key(r, c);
+    u64 result;
+
+    if (map_get(memo, key, &result)) {
+        return result;
     }
 
     int rr = r;
@@ -142,17 +149,15 @@ paths_from(const AocGrid *g, int r, int c)
         rr++;
     }
 
-    u64 result;
     if (rr >= H) {
         result = 1U;
     } else {
-        u64 left  = paths_from(g, rr, c - 1);
-        u64 right = paths_from(g, rr, c + 1);
+        u64 left  = paths_from(g, memo, rr, c - 1);
+        u64 right = paths_from(g, memo, rr, c + 1);
         result = left + right;
     }
 
-    dp_seen[r][c] = true;
-    dp_val[r][c] = result;
+    map_put(memo, key, result);
     return result;
 }
 
@@ -174,15 +179,14 @@ count_timelines(const AocGrid *g)
         return 0U;
     }
 
-    for (int r = 0; r < H; r++) {
-        for (int c = 0; c < W; c++) {
-            dp_seen[r][c] = false;
-            dp_val[r][c]  = 0U;
-        }
-    }
+    AocMap memo;
+    map_init(&memo, 1024U);
 
     int start_r = sr + 1;
-    return paths_from(g, start_r, sc);
+    u64 timelines = paths_from(g, &memo, start_r, sc);
+
+    map_free(&memo);
+    return timelines;
 }
 
 int
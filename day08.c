@@ -14,11 +14,25 @@ typedef struct {
 	i64 z;
 } Pt;
 
-typedef struct {
-	u64 d2; // squared distance
-	int a;  // index of first point
-	int b;  // index of second point
-} Edge;
+// Edges live in heaps as {d2, a:b}: key is the squared distance, val packs
+// the point indices with a in the high half, so ties on d2 break by (a, b).
+static inline u64
+edge_pack(int a, int b)
+{
+	return ((u64)(u32)a << 32) | (u64)(u32)b;
+}
+
+static inline int
+edge_a(u64 val)
+{
+	return (int)(val >> 32);
+}
+
+static inline int
+edge_b(u64 val)
+{
+	return (int)(u32)val;
+}
 
 static int parent_[MAX_PT];
 static int size_[MAX_PT];
@@ -79,42 +93,15 @@ sq_euclid(const Pt *p, const Pt *q)
 	return (u64)(dx * dx) + (u64)(dy * dy) + (u64)(dz * dz);
 }
 
-static int
-edge_cmp(const void *va, const void *vb)
-{
-	const Edge *ea = (const Edge *)va;
-	const Edge *eb = (const Edge *)vb;
-
-	if (ea->d2 < eb->d2) {
-		return -1;
-	}
-	if (ea->d2 > eb->d2) {
-		return 1;
-	}
-	if (ea->a != eb->a) {
-		return (ea->a < eb->a) ? -1 : 1;
-	}
-	if (ea->b != eb->b) {
-		return (ea->b < eb->b) ? -1 : 1;
-	}
-	return 0;
-}
-
-// Part 1
+// Part 1: edges holds the K shortest edges in ascending order.
 static u64
-solve_part1(const Edge *edges, size_t ecount, int n, u64 K)
+solve_part1(const AocHeapItem *edges, size_t ecount, int n)
 {
 	uf_init(n);
 
-	u64 limit_u = (u64)ecount;
-	if (limit_u > K) {
-		limit_u = K;
-	}
-	size_t limit = (size_t)limit_u;
-
-	for (size_t k = 0; k < limit; k++) {
-		int a = edges[k].a;
-		int b = edges[k].b;
+	for (size_t k = 0; k < ecount; k++) {
+		int a = edge_a(edges[k].val);
+		int b = edge_b(edges[k].val);
 		int ra = uf_find(a);
 		int rb = uf_find(b);
 		if (ra != rb) {
@@ -147,8 +134,10 @@ solve_part1(const Edge *edges, size_t ecount, int n, u64 K)
 
 // Part 2
 
+// Kruskal over a heap of all edges: only the edges up to the one that joins
+// the last two components are ever popped.
 static u64
-solve_part2(const Edge *edges, size_t ecount, int n, const Pt *pts)
+solve_part2(AocHeap *edges, int n, const Pt *pts)
 {
 	if (n <= 1) {
 		return 0U;
@@ -159,9 +148,11 @@ solve_part2(const Edge *edges, size_t ecount, int n, const Pt *pts)
 	int last_a = -1;
 	int last_b = -1;
 
-	for (size_t k = 0; k < ecount; k++) {
-		int a = edges[k].a;
-		int b = edges[k].b;
+	AocHeapItem e;
+
+	while (heap_pop(edges, &e)) {
+		int a = edge_a(e.val);
+		int b = edge_b(e.val);
 		int ra = uf_find(a);
 		int rb = uf_find(b);
 
@@ -243,18 +234,22 @@ main(void)
 	}
 
 	size_t ecount = (size_t)ecount_u;
-	Edge *edges = (Edge *)malloc(ecount * sizeof(Edge));
+	AocHeapItem *edges = (AocHeapItem *)malloc(ecount * sizeof(AocHeapItem));
 	if (edges == NULL) {
 		fprintf(stderr, "Out of memory allocating edges.\n");
 		return EXIT_FAILURE;
 	}
 
+	const u64 K = 1000U;
+	AocTopK nearest;
+	topk_init(&nearest, (size_t)K);
+
 	size_t idx = 0;
 	for (int i = 0; i < n; i++) {
 		for (int j = i + 1; j < n; j++) {
-			edges[idx].a = i;
-			edges[idx].b = j;
-			edges[idx].d2 = sq_euclid(&pts[i], &pts[j]);
+			edges[idx].key = sq_euclid(&pts[i], &pts[j]);
+			edges[idx].val = edge_pack(i, j);
+			topk_offer(&nearest, edges[idx].key, edges[idx].val);
 			idx++;
 		}
 	}
@@ -262,19 +257,21 @@ main(void)
 	if (idx != ecount) {
 		fprintf(stderr, "Edge count mismatch.\n");
 		free(edges);
+		topk_free(&nearest);
 		return EXIT_FAILURE;
 	}
 
-	qsort(edges, ecount, sizeof(Edge), edge_cmp);
-
-	const u64 K = 1000U;
+	const AocHeapItem *shortest = topk_sorted(&nearest);
+	u64 part1 = solve_part1(shortest, nearest.n, n);
+	topk_free(&nearest);
 
-	u64 part1 = solve_part1(edges, ecount, n, K);
-	u64 part2 = solve_part2(edges, ecount, n, pts);
+	AocHeap heap;
+	heap_build(&heap, edges, ecount); // takes ownership of edges
+	u64 part2 = solve_part2(&heap, n, pts);
+	heap_free(&heap);
 
 	printf("Part1: %" PRIu64 "\n", part1);
 	printf("Part2: %" PRIu64 "\n", part2);
 
-	free(edges);
 	return EXIT_SUCCESS;
 }
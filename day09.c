@@ -107,29 +107,13 @@ main(void)
 	int W = (int)span_x;
 	int H = (int)span_y;
 
-	int GW = W + 2;
-	int GH = H + 2;
-
-	unsigned char **grid = (unsigned char **)malloc((size_t)GH * sizeof(*grid));
-	bool          **used = (bool **)malloc((size_t)GH * sizeof(*used));
-	if (grid == NULL || used == NULL) {
-		fprintf(stderr, "Out of memory (rows).\n");
+	int *xs = (int *)malloc((size_t)n * sizeof(int));
+	int *ys = (int *)malloc((size_t)n * sizeof(int));
+	if (xs == NULL || ys == NULL) {
+		fprintf(stderr, "Out of memory (vertices).\n");
 		return EXIT_FAILURE;
 	}
 
-	for (int r = 0; r < GH; r++) {
-		grid[r] = (unsigned char *)malloc((size_t)GW * sizeof(unsigned char));
-		used[r] = (bool *)malloc((size_t)GW * sizeof(bool));
-		if (grid[r] == NULL || used[r] == NULL) {
-			fprintf(stderr, "Out of memory (grid/used).\n");
-			return EXIT_FAILURE;
-		}
-		for (int c = 0; c < GW; c++) {
-			grid[r][c] = '.';
-			used[r][c] = false;
-		}
-	}
-
 	for (int i = 0; i < n; i++) {
 		int row = (int)(pts[i].y - min_y) + 1;
 		int col = (int)(pts[i].x - min_x) + 1;
@@ -141,119 +125,29 @@ main(void)
 
 		pts[i].row = row;
 		pts[i].col = col;
-		grid[row][col] = '#'; /* red */
+		xs[i] = col - 1;
+		ys[i] = row - 1;
 	}
 
-	for (int i = 0; i < n; i++) {
-		int j = (i + 1 == n) ? 0 : (i + 1);
-
-		int r0 = pts[i].row;
-		int c0 = pts[i].col;
-		int r1 = pts[j].row;
-		int c1 = pts[j].col;
-
-		if (r0 == r1) {
-			int dc = (c1 > c0) ? 1 : -1;
-			for (int c = c0 + dc; c != c1; c += dc) {
-				if (grid[r0][c] == '.') {
-					grid[r0][c] = 'G';
-				}
-			}
-		} else if (c0 == c1) {
-			/* vertical segment */
-			int dr = (r1 > r0) ? 1 : -1;
-			for (int r = r0 + dr; r != r1; r += dr) {
-				if (grid[r][c0] == '.') {
-					grid[r][c0] = 'G';
-				}
-			}
-		} else {
-			fprintf(stderr, "Non-axial edge between points %d and %d.\n", i, j);
-			return EXIT_FAILURE;
-		}
-	}
-
-	int qcap = GW * GH;
-	int *qr = (int *)malloc((size_t)qcap * sizeof(int));
-	int *qc = (int *)malloc((size_t)qcap * sizeof(int));
-	if (qr == NULL || qc == NULL) {
-		fprintf(stderr, "Out of memory (queue).\n");
+	/*
+	 * pf is a (H + 1) x (W + 1) summed-area table of tiles that are neither
+	 * red nor green, i.e. outside the loop.  The scanline fill writes it
+	 * directly from the polygon's edges.
+	 */
+	size_t S = (size_t)W + 1U;
+	u32 *pf = (u32 *)malloc((size_t)(H + 1) * S * sizeof(u32));
+	if (pf == NULL) {
+		fprintf(stderr, "Out of memory (prefix table).\n");
 		return EXIT_FAILURE;
 	}
 
-	int head = 0;
-	int tail = 0;
-
-	used[0][0] = true;
-	qr[tail] = 0;
-	qc[tail] = 0;
-	tail++;
-
-	static const int dr[4] = { -1, 1, 0, 0 };
-	static const int dc[4] = {  0, 0,-1, 1 };
-
-	while (head < tail) {
-		int r = qr[head];
-		int c = qc[head];
-		head++;
-
-		for (int k = 0; k < 4; k++) {
-			int nr = r + dr[k];
-			int nc = c + dc[k];
-
-			if (nr < 0 || nr >= GH || nc < 0 || nc >= GW) {
-				continue;
-			}
-			if (used[nr][nc]) {
-				continue;
-			}
-			if (grid[nr][nc] != '.') {
-				continue;
-			}
-			used[nr][nc] = true;
-			qr[tail] = nr;
-			qc[tail] = nc;
-			tail++;
-		}
-	}
-
-	free(qr);
-	free(qc);
-
-	for (int r = 1; r <= H; r++) {
-		for (int c = 1; c <= W; c++) {
-			if (grid[r][c] == '.' && !used[r][c]) {
-				grid[r][c] = 'G';
-			}
-		}
-	}
-
-	u32 **pf = (u32 **)malloc((size_t)(H + 1) * sizeof(*pf));
-	if (pf == NULL) {
-		fprintf(stderr, "Out of memory (prefix rows).\n");
+	if (!poly_fill_sat(pf, W, H, xs, ys, n, false)) {
+		fprintf(stderr, "Non-axial edge in red tile loop.\n");
 		return EXIT_FAILURE;
 	}
-	for (int r = 0; r <= H; r++) {
-		pf[r] = (u32 *)malloc((size_t)(W + 1) * sizeof(u32));
-		if (pf[r] == NULL) {
-			fprintf(stderr, "Out of memory (prefix cols).\n");
-			return EXIT_FAILURE;
-		}
-		for (int c = 0; c <= W; c++) {
-			pf[r][c] = 0U;
-		}
-	}
 
-	for (int r = 1; r <= H; r++) {
-		for (int c = 1; c <= W; c++) {
-			bool forbidden = !(grid[r][c] == '#' || grid[r][c] == 'G');
-			u32 val = forbidden ? 1U : 0U;
-			pf[r][c] = val
-			     + pf[r - 1][c]
-			     + pf[r][c - 1]
-			     - pf[r - 1][c - 1];
-		}
-	}
+	free(xs);
+	free(ys);
 
 	u64 best_part1 = 0U;
 	u64 best_part2 = 0U;
@@ -279,10 +173,10 @@ main(void)
 			}
 
 			u32 sum_forbid =
-			    pf[rmax][cmax]
-			  - pf[rmin - 1][cmax]
-			  - pf[rmax][cmin - 1]
-			  + pf[rmin - 1][cmin - 1];
+			    pf[(size_t)rmax * S + (size_t)cmax]
+			  - pf[(size_t)(rmin - 1) * S + (size_t)cmax]
+			  - pf[(size_t)rmax * S + (size_t)(cmin - 1)]
+			  + pf[(size_t)(rmin - 1) * S + (size_t)(cmin - 1)];
 
 			if (sum_forbid == 0U && area > best_part2) {
 				best_part2 = area;
@@ -293,16 +187,6 @@ main(void)
 	printf("Part1: %" PRIu64 "\n", best_part1);
 	printf("Part2: %" PRIu64 "\n", best_part2);
 
-	for (int r = 0; r < GH; r++) {
-		free(grid[r]);
-		free(used[r]);
-	}
-	free(grid);
-	free(used);
-
-	for (int r = 0; r <= H; r++) {
-		free(pf[r]);
-	}
 	free(pf);
 
 	return EXIT_SUCCESS;
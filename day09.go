@@ -140,46 +140,21 @@ func solvePart2(pts []Pt) int64 {
 	H := maxRow + 1
 	W := maxCol + 1
 
-	// Grid with one-cell border all around
-	GH := H + 2
-	GW := W + 2
-
-	grid := make([][]byte, GH)
-	used := make([][]bool, GH)
-	for r := 0; r < GH; r++ {
-		grid[r] = make([]byte, GW)
-		used[r] = make([]bool, GW)
-		for c := 0; c < GW; c++ {
-			grid[r][c] = '.' // default: outside
-		}
-	}
-
-	// Draw polygon edges: connect consecutive red points (including wrap),
-	// using compressed coords shifted by +1 for the border margin.
+	// Collect vertical edges; horizontal edges are implied by the rows
+	// where a vertical edge starts or ends.
+	type vedge struct{ x, y0, y1 int }
+	edges := make([]vedge, 0, n)
 	for i := 0; i < n; i++ {
 		j := (i + 1) % n
-		r1 := pts[i].row + 1
-		c1 := pts[i].col + 1
-		r2 := pts[j].row + 1
-		c2 := pts[j].col + 1
+		r1, c1 := pts[i].row, pts[i].col
+		r2, c2 := pts[j].row, pts[j].col
 
-		if r1 == r2 {
-			// horizontal segment
-			if c1 > c2 {
-				c1, c2 = c2, c1
-			}
-			for c := c1; c <= c2; c++ {
-				grid[r1][c] = '#'
-			}
-		} else if c1 == c2 {
-			// vertical segment
+		if c1 == c2 && r1 != r2 {
 			if r1 > r2 {
 				r1, r2 = r2, r1
 			}
-			for r := r1; r <= r2; r++ {
-				grid[r][c1] = '#'
-			}
-		} else {
+			edges = append(edges, vedge{c1, r1, r2})
+		} else if r1 != r2 {
 			// This *should never happen* for valid AoC input.
 			fmt.Fprintf(os.Stderr,
 				"non-axis-aligned edge between points %d and %d\n"+
@@ -192,80 +167,45 @@ func solvePart2(pts []Pt) int64 {
 			os.Exit(1)
 		}
 	}
+	sort.Slice(edges, func(i, j int) bool { return edges[i].x < edges[j].x })
 
-	// Flood-fill from outside border to find reachable '.' cells.
-	// Any '.' that are NOT reached are interior → green.
-	qr := make([]int, 0, GH*GW)
-	qc := make([]int, 0, GH*GW)
-	push := func(r, c int) {
-		used[r][c] = true
-		qr = append(qr, r)
-		qc = append(qc, c)
-	}
-
-	// Enqueue all border cells that are '.'
-	for c := 0; c < GW; c++ {
-		if grid[0][c] == '.' && !used[0][c] {
-			push(0, c)
-		}
-		if grid[GH-1][c] == '.' && !used[GH-1][c] {
-			push(GH-1, c)
-		}
-	}
-	for r := 0; r < GH; r++ {
-		if grid[r][0] == '.' && !used[r][0] {
-			push(r, 0)
-		}
-		if grid[r][GW-1] == '.' && !used[r][GW-1] {
-			push(r, GW-1)
-		}
-	}
-
-	dr := [4]int{-1, 1, 0, 0}
-	dc := [4]int{0, 0, -1, 1}
-
-	head := 0
-	for head < len(qr) {
-		r := qr[head]
-		c := qc[head]
-		head++
-
-		for k := 0; k < 4; k++ {
-			nr := r + dr[k]
-			nc := c + dc[k]
-			if nr < 0 || nr >= GH || nc < 0 || nc >= GW {
-				continue
-			}
-			if used[nr][nc] {
-				continue
-			}
-			if grid[nr][nc] != '.' {
-				continue
-			}
-			push(nr, nc)
-		}
-	}
-
-	// Any '.' not reached is interior → mark as 'G'
-	for r := 0; r < GH; r++ {
-		for c := 0; c < GW; c++ {
-			if grid[r][c] == '.' && !used[r][c] {
-				grid[r][c] = 'G'
-			}
-		}
-	}
-
-	// Build 2D prefix sums over interior region [0..H-1][0..W-1]
-	// Count "bad" cells = outside '.'; allowed cells are '#' or 'G'.
+	// Scanline fill: a cell is inside (red or green) if the boundary
+	// crosses an odd number of times just above or just below its centre
+	// row to the left.  Each row yields inclusive [x0, x1] spans which go
+	// straight into 2D prefix sums of "bad" (outside) cells.
 	pf := make([][]int, H+1)
 	for r := 0; r <= H; r++ {
 		pf[r] = make([]int, W+1)
 	}
 
+	inside := make([]bool, W)
 	for r := 0; r < H; r++ {
+		for c := range inside {
+			inside[c] = false
+		}
+		up, dn := false, false
+		start := 0
+		for i := 0; i < len(edges); {
+			x := edges[i].x
+			was := up || dn
+			for ; i < len(edges) && edges[i].x == x; i++ {
+				e := edges[i]
+				up = up != (e.y0 < r && r <= e.y1)
+				dn = dn != (e.y0 <= r && r < e.y1)
+			}
+			now := up || dn
+			if !was && now {
+				start = x
+			} else if was && !now {
+				for c := start; c <= x; c++ {
+					inside[c] = true
+				}
+			}
+		}
+
 		rowSum := 0
 		for c := 0; c < W; c++ {
-			if grid[r+1][c+1] == '.' {
+			if !inside[c] {
 				rowSum++
 			}
 			pf[r+1][c+1] = pf[r][c+1] + rowSum
@@ -308,4 +248,3 @@ func solvePart2(pts []Pt) int64 {
 
 	return best2
 }
-
@@ -7,10 +7,6 @@
 
 #include "aoc.h"
 
-#ifndef MAX_LIGHTS
-#define MAX_LIGHTS 20      // max indicator lights per machine 
-#endif
-
 #ifndef MAX_BUTTONS
 #define MAX_BUTTONS 64     // max buttons per machine 
 #endif
@@ -19,6 +15,14 @@
 #define MAX_CNTS 16        // max joltage counters per machine 
 #endif
 
+#ifndef MAX_FREE_LIGHT_BUTTONS
+#define MAX_FREE_LIGHT_BUTTONS 30  // 2^n press plans tried in Part 1 
+#endif
+
+#ifndef MAX_BFS_LIGHTS
+#define MAX_BFS_LIGHTS 20  // 2^L light states searched in Part 1 
+#endif
+
 typedef struct {
     int count;
     int idx[MAX_CNTS];  // indices toggled / incremented by this button 
@@ -26,8 +30,8 @@ typedef struct {
 
 typedef struct {
     // Part 1: lights 
-    int  lights_n;       // number of lights L 
-    u64  lights_target;  // bitmask target pattern 
+    int     lights_n;       // number of lights L 
+    AocBits lights_target;  // target pattern, bit i = light i on 
 
     // Part 2: joltage counters 
     int  cnt_n;          // number of counters 
@@ -44,8 +48,7 @@ parse_pattern(const char **pp, Machine *m, const char *line)
 {
     const char *p = *pp;
 
-    m->lights_n      = 0;
-    m->lights_target = 0U;
+    m->lights_n = 0;
 
     while (*p == ' ' || *p == '\t') {
         p++;
@@ -60,20 +63,14 @@ parse_pattern(const char **pp, Machine *m, const char *line)
     }
     p++;  // after '[' 
 
-    int  L = 0;
-    u64  mask = 0U;
+    // count first so the target bitset is sized once
+    const char *end = p;
+    int         L   = 0;
 
-    while (*p != '\0' && *p != ']') {
-        char ch = *p;
+    while (*end != '\0' && *end != ']') {
+        char ch = *end;
 
         if (ch == '.' || ch == '#') {
-            if (L >= MAX_LIGHTS) {
-                fprintf(stderr, "Too many lights (> %d)\n", MAX_LIGHTS);
-                return false;
-            }
-            if (ch == '#') {
-                mask |= (1ULL << L);
-            }
             L++;
         } else if (ch == ' ' || ch == '\t') {
             // ignore whitespace inside pattern 
@@ -82,22 +79,31 @@ parse_pattern(const char **pp, Machine *m, const char *line)
                     ch, line);
             return false;
         }
-        p++;
+        end++;
     }
 
-    if (*p != ']') {
+    if (*end != ']') {
         fprintf(stderr, "Missing ']' in line: '%s'\n", line);
         return false;
     }
-    p++;  // after ']' 
 
     if (L <= 0) {
         fprintf(stderr, "Empty pattern in line: '%s'\n", line);
         return false;
     }
 
-    m->lights_n      = L;
-    m->lights_target = mask;
+    bits_init(&m->lights_target, L);
+    for (int i = 0; p < end; p++) {
+        if (*p == '#') {
+            bits_set(&m->lights_target, i);
+        }
+        if (*p == '.' || *p == '#') {
+            i++;
+        }
+    }
+    p++;  // after ']' 
+
+    m->lights_n = L;
     *pp = p;
     return true;
 }
@@ -289,7 +295,7 @@ parse_machine(const char *line, Machine *m)
     const char *p = line;
 
     m->lights_n      = 0;
-    m->lights_target = 0U;
+    m->lights_target = (AocBits){0};
     m->cnt_n         = 0;
     m->btn_n         = 0;
 
@@ -309,18 +315,25 @@ parse_machine(const char *line, Machine *m)
     return true;
 }
 
+static void
+machine_free(Machine *m)
+{
+    bits_free(&m->lights_target);
+}
+
 static bool
 build_light_masks(const Machine *m,
                   int L,
-                  u64 masks_out[MAX_BUTTONS],
+                  AocBits masks_out[MAX_BUTTONS],
                   int *mask_count_out)
 {
     int count = 0;
 
     for (int bi = 0; bi < m->btn_n; bi++) {
         const Button *b = &m->btns[bi];
-        u64 mask = 0U;
+        AocBits mask;
 
+        bits_init(&mask, L);
         for (int k = 0; k < b->count; k++) {
             int idx = b->idx[k];
 
@@ -328,35 +341,44 @@ build_light_masks(const Machine *m,
                 continue;
             }
 
-            mask |= (1ULL << (u64)idx);
+            bits_set(&mask, idx);
         }
 
-        if (mask != 0U) {
-            if (count >= MAX_BUTTONS) {
-                fprintf(stderr,
-                    "Too many effective light buttons (> %d)\n",
-                    MAX_BUTTONS);
-                return false;
+        if (!bits_any(&mask)) {
+            bits_free(&mask);
+            continue;
+        }
+        if (count >= MAX_BUTTONS) {
+            fprintf(stderr,
+                "Too many effective light buttons (> %d)\n",
+                MAX_BUTTONS);
+            bits_free(&mask);
+            for (int i = 0; i < count; i++) {
+                bits_free(&masks_out[i]);
             }
-            masks_out[count++] = mask;
+            return false;
         }
+        masks_out[count++] = mask;
     }
 
     *mask_count_out = count;
     return (count > 0);
 }
 
+// Breadth-first search over the 2^L light states, for machines with more
+// redundant buttons than lights.
 static int
 bfs_min_presses_lights(int L,
-                       u64 target,
-                       const u64 masks[MAX_BUTTONS],
+                       const AocBits *target,
+                       const AocBits masks[MAX_BUTTONS],
                        int mask_count)
 {
-    if (L <= 0 || L > MAX_LIGHTS) {
+    if (L <= 0 || L > MAX_BFS_LIGHTS) {
         return -1;
     }
 
     u32 state_count = (u32)(1U << L);
+    u32 goal        = (u32)target->w[0];
 
     int *dist = (int *)malloc((size_t)state_count * sizeof(int));
     u32 *queue = (u32 *)malloc((size_t)state_count * sizeof(u32));
@@ -382,7 +404,7 @@ bfs_min_presses_lights(int L,
         u32 s = queue[head++];
         int d = dist[s];
 
-        if ((u64)s == target) {
+        if (s == goal) {
             int answer = d;
             free(dist);
             free(queue);
@@ -390,8 +412,7 @@ bfs_min_presses_lights(int L,
         }
 
         for (int bi = 0; bi < mask_count; bi++) {
-            u64 ns_u64 = (u64)s ^ masks[bi];
-            u32 ns = (u32)ns_u64;
+            u32 ns = s ^ (u32)masks[bi].w[0];
 
             if (dist[ns] == -1) {
                 dist[ns] = d + 1;
@@ -405,25 +426,117 @@ bfs_min_presses_lights(int L,
     return -1;
 }
 
+// Pressing a button twice cancels out, so a press plan is a set of buttons
+// whose masks XOR to the target.  Eliminate over GF(2), then walk the null
+// space in Gray-code order for the plan with the fewest presses.  When the
+// null space has more dimensions than there are lights, searching the
+// light states instead is cheaper.
+static int
+solve_lights_gf2(const AocBits *target,
+                 const AocBits masks[MAX_BUTTONS],
+                 int mask_count)
+{
+    AocBits rows[MAX_BUTTONS];    // reduced basis, pivot[j] is its lowest bit 
+    u64     combo[MAX_BUTTONS];   // buttons XORed together to make rows[j] 
+    int     pivot[MAX_BUTTONS];
+    u64     kernel[MAX_BUTTONS];  // button sets that toggle nothing 
+    int     rank     = 0;
+    int     kernel_n = 0;
+
+    for (int bi = 0; bi < mask_count; bi++) {
+        AocBits v = {0};
+        u64     c = 1ULL << bi;
+
+        bits_copy(&v, &masks[bi]);
+        for (int j = 0; j < rank; j++) {
+            if (bits_test(&v, pivot[j])) {
+                bits_xor(&v, &rows[j]);
+                c ^= combo[j];
+            }
+        }
+
+        int p = bits_first(&v);
+        if (p < 0) {
+            kernel[kernel_n++] = c;
+            bits_free(&v);
+            continue;
+        }
+        rows[rank]  = v;
+        combo[rank] = c;
+        pivot[rank] = p;
+        rank++;
+    }
+
+    AocBits t = {0};
+    u64     x = 0U;   // one particular solution 
+
+    bits_copy(&t, target);
+    for (int j = 0; j < rank; j++) {
+        if (bits_test(&t, pivot[j])) {
+            bits_xor(&t, &rows[j]);
+            x ^= combo[j];
+        }
+    }
+
+    bool reachable = !bits_any(&t);
+
+    bits_free(&t);
+    for (int j = 0; j < rank; j++) {
+        bits_free(&rows[j]);
+    }
+
+    if (!reachable) {
+        return -1;
+    }
+    if (kernel_n > target->nbits && target->nbits <= MAX_BFS_LIGHTS) {
+        return bfs_min_presses_lights(target->nbits, target, masks,
+                                      mask_count);
+    }
+    if (kernel_n > MAX_FREE_LIGHT_BUTTONS) {
+        fprintf(stderr,
+                "Too many redundant light buttons (> %d) for %d lights.\n",
+                MAX_FREE_LIGHT_BUTTONS, target->nbits);
+        return -1;
+    }
+
+    int best = __builtin_popcountll(x);
+    u64 cur  = x;
+
+    for (u64 g = 1U; g < (1ULL << kernel_n); g++) {
+        cur ^= kernel[__builtin_ctzll(g)];
+
+        int presses = __builtin_popcountll(cur);
+        if (presses < best) {
+            best = presses;
+        }
+    }
+
+    return best;
+}
+
 // Part 1
 static int
 min_presses_lights(const Machine *m)
 {
     int L = m->lights_n;
-    u64 target = m->lights_target;
 
-    if (target == 0U) {
+    if (!bits_any(&m->lights_target)) {
         return 0;
     }
 
-    u64 masks[MAX_BUTTONS];
-    int  mask_count = 0;
+    AocBits masks[MAX_BUTTONS];
+    int     mask_count = 0;
 
     if (!build_light_masks(m, L, masks, &mask_count)) {
         return -1;  // no useful buttons or error 
     }
 
-    return bfs_min_presses_lights(L, target, masks, mask_count);
+    int presses = solve_lights_gf2(&m->lights_target, masks, mask_count);
+
+    for (int i = 0; i < mask_count; i++) {
+        bits_free(&masks[i]);
+    }
+    return presses;
 }
 
 // Part 2
@@ -902,6 +1015,7 @@ main(void)
         }
         total_part2 += (u64)p2;
 
+        machine_free(&m);
         machine_index++;
     }
 
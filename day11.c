@@ -168,20 +168,19 @@ graph_free(Graph *g)
     g->n = 0;
 }
 
-// Memoization table: (node_index, mask) -> uint64
-// mask is 2 bits => 4 states per node. We can store in arrays.
-// visiting: detects cycles per (node,mask) recursion stack.
+// Memoization: (node_index, mask) -> uint64, keyed by node_index << 2 | mask.
+// mask is 2 bits (dac seen, fft seen).  Both maps grow with the states the
+// DFS actually reaches rather than with the node table capacity.
+// vis: detects cycles per (node,mask) recursion stack (1 while on the stack).
 typedef struct {
-    uint64_t *memo;    // size = cap*4, only valid where has_memo is true
-    uint8_t  *has;     // size = cap*4, 0/1
-    uint8_t  *vis;     // size = cap*4, 0/1
-    int       cap;     // same as graph cap
+    AocMap memo;
+    AocMap vis;
 } DP;
 
-static inline int
-dp_ix(int node_index, uint8_t mask)
+static inline uint64_t
+dp_key(int node_index, uint8_t mask)
 {
-    return (node_index << 2) | (int)(mask & 3U);
+    return ((uint64_t)node_index << 2) | (uint64_t)(mask & 3U);
 }
 
 static void
@@ -241,18 +240,19 @@ count_paths_with_devices(const Graph *g, DP *dp,
         return (mask == 3U) ? 1ULL : 0ULL;
     }
 
-    int idx = dp_ix(node, mask);
+    uint64_t key = dp_key(node, mask);
+    uint64_t val;
 
-    if (dp->has[idx]) {
-        return dp->memo[idx];
+    if (map_get(&dp->memo, key, &val)) {
+        return val;
     }
 
-    if (dp->vis[idx]) {
+    if (map_get(&dp->vis, key, &val) && val != 0U) {
         // cycle on current recursion stack => do not count infinite paths
         return 0ULL;
     }
 
-    dp->vis[idx] = 1U;
+    map_put(&dp->vis, key, 1U);
 
     uint64_t total = 0;
     const Node *nd = &g->tab[node];
@@ -261,9 +261,8 @@ count_paths_with_devices(const Graph *g, DP *dp,
         total += count_paths_with_devices(g, dp, next, target, dac, fft, mask);
     }
 
-    dp->vis[idx] = 0U;
-    dp->has[idx] = 1U;
-    dp->memo[idx] = total;
+    map_put(&dp->vis, key, 0U);
+    map_put(&dp->memo, key, total);
     return total;
 }
 
@@ -296,24 +295,15 @@ main(void)
         return 0;
     }
 
-    DP dp = {0};
-    dp.cap = g.cap;
-    size_t sz = (size_t)g.cap * 4U;
-
-    dp.memo = (uint64_t *)calloc(sz, sizeof(uint64_t));
-    dp.has  = (uint8_t  *)calloc(sz, sizeof(uint8_t));
-    dp.vis  = (uint8_t  *)calloc(sz, sizeof(uint8_t));
-    if (dp.memo == NULL || dp.has == NULL || dp.vis == NULL) {
-        fprintf(stderr, "out of memory\n");
-        exit(EXIT_FAILURE);
-    }
+    DP dp;
+    map_init(&dp.memo, (size_t)g.n);
+    map_init(&dp.vis, (size_t)g.n);
 
     uint64_t paths = count_paths_with_devices(&g, &dp, start, target, dac, fft, 0);
     printf("%" PRIu64 "\n", paths);
 
-    free(dp.memo);
-    free(dp.has);
-    free(dp.vis);
+    map_free(&dp.memo);
+    map_free(&dp.vis);
     graph_free(&g);
     return 0;
 }
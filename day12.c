@@ -355,51 +355,6 @@ read_shapes_and_regions(Shape *sh, int *sh_n, char regions[][MAX_LINE],
 	return 0;
 }
 
-static inline int
-nwords_for_board(int W, int H)
-{
-	int bits = W * H;
-	return (bits + 63) / 64;
-}
-
-static inline void
-bitset_zero(uint64_t *b, int nwords)
-{
-	memset(b, 0, (size_t)nwords * sizeof(uint64_t));
-}
-
-static inline void
-bitset_set(uint64_t *b, int idx)
-{
-	b[idx >> 6] |= 1ULL << (idx & 63);
-}
-
-static inline bool
-mask_overlaps(const uint64_t *occ, const uint64_t *m, int nwords)
-{
-	for (int i = 0; i < nwords; i++) {
-		if ((occ[i] & m[i]) != 0)
-			return true;
-	}
-	return false;
-}
-
-static inline void
-mask_apply(uint64_t *occ, const uint64_t *m, int nwords)
-{
-	for (int i = 0; i < nwords; i++)
-		occ[i] |= m[i];
-}
-
-static inline void
-mask_unapply(uint64_t *occ, const uint64_t *m, int nwords)
-{
-	// XOR is safe: this only unapply masks that were just applied and never
-	// overlap.
-	for (int i = 0; i < nwords; i++)
-		occ[i] ^= m[i];
-}
-
 // placement list: contiguous storage (n * nwords words)
 typedef struct {
 	uint64_t *data; // length cap*nwords
@@ -433,8 +388,8 @@ static void
 build_placements_for_shape(PlaceList *out, const Shape *s, int W, int H,
     int nwords)
 {
-	// Temporary mask buffer; nwords <= 64 for all reasonable boards here.
-	uint64_t tmp[64];
+	AocBits tmp;
+	bits_init(&tmp, W * H);
 
 	for (int oi = 0; oi < s->ori_n; oi++) {
 		const Poly *p = &s->ori[oi];
@@ -443,17 +398,19 @@ build_placements_for_shape(PlaceList *out, const Shape *s, int W, int H,
 
 		for (int y0 = 0; y0 <= H - p->h; y0++) {
 			for (int x0 = 0; x0 <= W - p->w; x0++) {
-				bitset_zero(tmp, nwords);
+				bits_clear(&tmp);
 				for (int ci = 0; ci < p->n; ci++) {
 					int x = x0 + p->c[ci].x;
 					int y = y0 + p->c[ci].y;
 					int idx = y * W + x;
-					bitset_set(tmp, idx);
+					bits_set(&tmp, idx);
 				}
-				placelist_push(out, tmp, nwords);
+				placelist_push(out, tmp.w, nwords);
 			}
 		}
 	}
+
+	bits_free(&tmp);
 }
 
 static void
@@ -497,13 +454,9 @@ parity_prune_possible(const Shape *sh, int sh_n, int W, int H, const int *need,
 			sumD = area_sum;
 	}
 
-	int nbits = sumD + 1;
-	int nwords = (nbits + 63) / 64;
-	uint64_t *dp = (uint64_t *)calloc((size_t)nwords, sizeof(uint64_t));
-	if (!dp)
-		return true; // skip prune if OOM
-
-	dp[0] = 1ULL;
+	AocBits dp;
+	bits_init(&dp, sumD + 1);
+	bits_set(&dp, 0);
 
 	for (int si = 0; si < sh_n; si++) {
 		int cnt = (si < need_n) ? need[si] : 0;
@@ -518,34 +471,12 @@ parity_prune_possible(const Shape *sh, int sh_n, int W, int H, const int *need,
 		if (d == 0)
 			continue;
 
-		for (int rep = 0; rep < cnt; rep++) {
-			int shift = d;
-			int wshift = shift / 64;
-			int bshift = shift % 64;
-
-			for (int i = nwords - 1; i >= 0; i--) {
-				uint64_t v = 0;
-				int src = i - wshift;
-				if (src >= 0) {
-					v |= dp[src] << bshift;
-					if (bshift && src - 1 >= 0)
-						v |= dp[src - 1] >>
-						     (64 - bshift);
-				}
-				dp[i] |= v;
-			}
-
-			int extra = (nwords * 64) - nbits;
-			if (extra > 0)
-				dp[nwords - 1] &= (~0ULL) >> extra;
-		}
+		for (int rep = 0; rep < cnt; rep++)
+			bits_shl_or(&dp, d);
 	}
 
 	bool ok = false;
-	for (int t = 0; t <= sumD; t++) {
-		if ((dp[t / 64] & (1ULL << (t % 64))) == 0)
-			continue;
-
+	for (int t = bits_first(&dp); t >= 0; t = bits_next(&dp, t)) {
 		int signed_imb = sumD - 2 * t;
 		if (((area_sum + signed_imb) & 1) != 0)
 			continue;
@@ -561,7 +492,7 @@ parity_prune_possible(const Shape *sh, int sh_n, int W, int H, const int *need,
 		}
 	}
 
-	free(dp);
+	bits_free(&dp);
 	return ok;
 }
 
@@ -579,8 +510,7 @@ typedef struct {
 	int last_idx[MAX_SHAPES];
 	int area[MAX_SHAPES];
 
-	uint64_t occ[64]; // up to 64 words (supports boards up to 4096 bits
-			  // comfortably)
+	AocBits occ; // W*H bits, row-major
 
 	int remaining_area;
 	int free_cells;
@@ -605,7 +535,7 @@ choose_next_type(Ctx *c)
 		for (int i = start; i < pl->n; i++) {
 			const uint64_t *m =
 			    &pl->data[(size_t)i * (size_t)c->nwords];
-			if (!mask_overlaps(c->occ, m, c->nwords)) {
+			if (!bitw_intersects(c->occ.w, m, c->nwords)) {
 				cnt++;
 				if (cnt >= best_count)
 					break;
@@ -654,20 +584,21 @@ dfs(Ctx *c)
 
 	for (int i = start; i < pl->n; i++) {
 		const uint64_t *m = &pl->data[(size_t)i * (size_t)c->nwords];
-		if (mask_overlaps(c->occ, m, c->nwords))
+		if (bitw_intersects(c->occ.w, m, c->nwords))
 			continue;
 
 		c->last_idx[t] = i; // symmetry breaking: increasing indices per
 				    // identical type
 
-		mask_apply(c->occ, m, c->nwords);
+		bitw_or(c->occ.w, m, c->nwords);
 		c->free_cells -= c->area[t];
 
 		if (dfs(c))
 			return true;
 
 		c->free_cells += c->area[t];
-		mask_unapply(c->occ, m, c->nwords);
+		// XOR is safe: m was just applied and does not overlap.
+		bitw_xor(c->occ.w, m, c->nwords);
 	}
 
 	// undo instance
@@ -686,16 +617,10 @@ solve_region_fast(const Shape *sh, int sh_n, int W, int H, const int *need_in,
 	memset(&c, 0, sizeof c);
 	c.W = W;
 	c.H = H;
-	c.nwords = nwords_for_board(W, H);
+	c.nwords = bits_nwords(W * H);
 	c.sh = sh;
 	c.sh_n = sh_n;
 
-	if (c.nwords > (int)(sizeof c.occ / sizeof c.occ[0])) {
-		// unreachable??
-		// Shouldn't happen for AoC input sizes; keep safe.
-		return false;
-	}
-
 	int area_sum = 0;
 	int min_piece_area = INT_MAX;
 
@@ -749,12 +674,13 @@ solve_region_fast(const Shape *sh, int sh_n, int W, int H, const int *need_in,
 		}
 	}
 
-	bitset_zero(c.occ, c.nwords);
+	bits_init(&c.occ, W * H);
 	c.remaining_area = area_sum;
 	c.free_cells = W * H;
 
 	bool ok = dfs(&c);
 
+	bits_free(&c.occ);
 	for (int i = 0; i < sh_n; i++)
 		placelist_free(&c.place[i]);
 	return ok;
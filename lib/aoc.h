@@ -350,4 +350,921 @@ split_fields(char *s, char **out, int out_cap)
     return n;
 }
 
+// Word-span bitset kernels over n u64 words.  The element-wise ops are plain
+// restrict loops the compiler vectorises; the reductions run four words per
+// step so they vectorise as well and only branch once per block.  dst and src
+// must not overlap.
+static inline void
+bitw_and(u64 *restrict dst, const u64 *restrict src, int n)
+{
+	for (int i = 0; i < n; i++) {
+		dst[i] &= src[i];
+	}
+}
+
+static inline void
+bitw_or(u64 *restrict dst, const u64 *restrict src, int n)
+{
+	for (int i = 0; i < n; i++) {
+		dst[i] |= src[i];
+	}
+}
+
+static inline void
+bitw_xor(u64 *restrict dst, const u64 *restrict src, int n)
+{
+	for (int i = 0; i < n; i++) {
+		dst[i] ^= src[i];
+	}
+}
+
+// dst &= ~src
+static inline void
+bitw_andnot(u64 *restrict dst, const u64 *restrict src, int n)
+{
+	for (int i = 0; i < n; i++) {
+		dst[i] &= ~src[i];
+	}
+}
+
+static inline bool
+bitw_any(const u64 *w, int n)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		if ((w[i] | w[i + 1] | w[i + 2] | w[i + 3]) != 0U) {
+			return true;
+		}
+	}
+	for (; i < n; i++) {
+		if (w[i] != 0U) {
+			return true;
+		}
+	}
+	return false;
+}
+
+// True if a & b has any bit set; does not write anything.
+static inline bool
+bitw_intersects(const u64 *a, const u64 *b, int n)
+{
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		u64 x = (a[i] & b[i]) | (a[i + 1] & b[i + 1]) |
+		    (a[i + 2] & b[i + 2]) | (a[i + 3] & b[i + 3]);
+		if (x != 0U) {
+			return true;
+		}
+	}
+	for (; i < n; i++) {
+		if ((a[i] & b[i]) != 0U) {
+			return true;
+		}
+	}
+	return false;
+}
+
+static inline u64
+bitw_popcount(const u64 *w, int n)
+{
+	u64 c0 = 0U, c1 = 0U, c2 = 0U, c3 = 0U;
+	int i = 0;
+	for (; i + 4 <= n; i += 4) {
+		c0 += (u64)__builtin_popcountll(w[i]);
+		c1 += (u64)__builtin_popcountll(w[i + 1]);
+		c2 += (u64)__builtin_popcountll(w[i + 2]);
+		c3 += (u64)__builtin_popcountll(w[i + 3]);
+	}
+	for (; i < n; i++) {
+		c0 += (u64)__builtin_popcountll(w[i]);
+	}
+	return c0 + c1 + c2 + c3;
+}
+
+// w |= w << shift, in place (subset-sum step).  Bits shifted past word n-1
+// are dropped.
+static inline void
+bitw_shl_or(u64 *w, int n, int shift)
+{
+	if (shift <= 0) {
+		return;
+	}
+	int ws = shift >> 6;
+	int bs = shift & 63;
+
+	// high to low so every source word is read before it is updated
+	for (int i = n - 1; i >= ws; i--) {
+		int src = i - ws;
+		u64 v = w[src] << bs;
+		if (bs != 0 && src > 0) {
+			v |= w[src - 1] >> (64 - bs);
+		}
+		w[i] |= v;
+	}
+}
+
+// Index of the first set bit >= from, or -1.
+static inline int
+bitw_next(const u64 *w, int n, int from)
+{
+	if (from < 0) {
+		from = 0;
+	}
+	int i = from >> 6;
+	if (i >= n) {
+		return -1;
+	}
+	u64 x = w[i] & (~0ULL << (from & 63));
+	while (x == 0U) {
+		if (++i >= n) {
+			return -1;
+		}
+		x = w[i];
+	}
+	return (i << 6) + __builtin_ctzll(x);
+}
+
+// Dynamic bitset.  Bit i lives in w[i >> 6] at position i & 63; bits past
+// nbits in the last word are kept clear so whole-word kernels stay exact.
+typedef struct {
+	u64 *w;
+	int nbits;
+	int nwords;
+} AocBits;
+
+static inline int
+bits_nwords(int nbits)
+{
+	return (nbits + 63) / 64;
+}
+
+static inline void
+bits_init(AocBits *b, int nbits)
+{
+	b->nbits = nbits;
+	b->nwords = bits_nwords(nbits);
+	b->w = (u64 *)calloc((size_t)b->nwords + 1U, sizeof(u64));
+	if (b->w == NULL) {
+		fprintf(stderr, "out of memory\n");
+		exit(EXIT_FAILURE);
+	}
+}
+
+static inline void
+bits_free(AocBits *b)
+{
+	free(b->w);
+	b->w = NULL;
+	b->nbits = 0;
+	b->nwords = 0;
+}
+
+// Grow or shrink to nbits; kept bits are preserved, new bits are clear.
+static inline void
+bits_resize(AocBits *b, int nbits)
+{
+	int nw = bits_nwords(nbits);
+	if (nw != b->nwords) {
+		b->w = (u64 *)xrealloc(b->w, ((size_t)nw + 1U) * sizeof(u64));
+		for (int i = b->nwords; i < nw; i++) {
+			b->w[i] = 0U;
+		}
+		b->nwords = nw;
+	}
+	b->nbits = nbits;
+	if ((nbits & 63) != 0) {
+		b->w[nw - 1] &= (1ULL << (nbits & 63)) - 1U;
+	}
+}
+
+// Clears the unused high bits of the last word.
+static inline void
+bits_trim(AocBits *b)
+{
+	if ((b->nbits & 63) != 0) {
+		b->w[b->nwords - 1] &= (1ULL << (b->nbits & 63)) - 1U;
+	}
+}
+
+static inline void
+bits_clear(AocBits *b)
+{
+	memset(b->w, 0, (size_t)b->nwords * sizeof(u64));
+}
+
+static inline void
+bits_copy(AocBits *dst, const AocBits *src)
+{
+	if (dst->nbits != src->nbits) {
+		bits_resize(dst, src->nbits);
+	}
+	memcpy(dst->w, src->w, (size_t)src->nwords * sizeof(u64));
+}
+
+static inline void
+bits_set(AocBits *b, int i)
+{
+	b->w[i >> 6] |= 1ULL << (i & 63);
+}
+
+static inline void
+bits_reset(AocBits *b, int i)
+{
+	b->w[i >> 6] &= ~(1ULL << (i & 63));
+}
+
+static inline void
+bits_flip(AocBits *b, int i)
+{
+	b->w[i >> 6] ^= 1ULL << (i & 63);
+}
+
+static inline bool
+bits_test(const AocBits *b, int i)
+{
+	return (b->w[i >> 6] >> (i & 63)) & 1U;
+}
+
+// Sets bits [lo, hi).
+static inline void
+bits_set_range(AocBits *b, int lo, int hi)
+{
+	if (lo >= hi) {
+		return;
+	}
+	int wl = lo >> 6;
+	int wh = (hi - 1) >> 6;
+	u64 ml = ~0ULL << (lo & 63);
+	u64 mh = ~0ULL >> (63 - ((hi - 1) & 63));
+	if (wl == wh) {
+		b->w[wl] |= ml & mh;
+		return;
+	}
+	b->w[wl] |= ml;
+	for (int i = wl + 1; i < wh; i++) {
+		b->w[i] = ~0ULL;
+	}
+	b->w[wh] |= mh;
+}
+
+// Binary ops require equal sizes.
+static inline void
+bits_and(AocBits *dst, const AocBits *src)
+{
+	bitw_and(dst->w, src->w, dst->nwords);
+}
+
+static inline void
+bits_or(AocBits *dst, const AocBits *src)
+{
+	bitw_or(dst->w, src->w, dst->nwords);
+}
+
+static inline void
+bits_xor(AocBits *dst, const AocBits *src)
+{
+	bitw_xor(dst->w, src->w, dst->nwords);
+}
+
+static inline void
+bits_andnot(AocBits *dst, const AocBits *src)
+{
+	bitw_andnot(dst->w, src->w, dst->nwords);
+}
+
+static inline bool
+bits_any(const AocBits *b)
+{
+	return bitw_any(b->w, b->nwords);
+}
+
+static inline bool
+bits_intersects(const AocBits *a, const AocBits *b)
+{
+	return bitw_intersects(a->w, b->w, a->nwords);
+}
+
+static inline u64
+bits_popcount(const AocBits *b)
+{
+	return bitw_popcount(b->w, b->nwords);
+}
+
+// b |= b << shift, truncated to nbits.
+static inline void
+bits_shl_or(AocBits *b, int shift)
+{
+	bitw_shl_or(b->w, b->nwords, shift);
+	bits_trim(b);
+}
+
+// First set bit, or -1.
+static inline int
+bits_first(const AocBits *b)
+{
+	return bitw_next(b->w, b->nwords, 0);
+}
+
+// First set bit after i, or -1.  Iterate with
+//   for (int i = bits_first(b); i >= 0; i = bits_next(b, i))
+static inline int
+bits_next(const AocBits *b, int i)
+{
+	return bitw_next(b->w, b->nwords, i + 1);
+}
+
+// Priority queue item.  Heaps order by key, then by val, so equal keys come
+// out in a deterministic order.
+typedef struct {
+	u64 key;
+	u64 val;
+} AocHeapItem;
+
+static inline bool
+heap_item_less(AocHeapItem x, AocHeapItem y)
+{
+	return x.key < y.key || (x.key == y.key && x.val < y.val);
+}
+
+// Shared 4-ary sift helpers; max selects a max-heap.  Four 16-byte children
+// fill one cache line, and the tree is half as deep as a binary heap.
+static inline bool
+heap4_before_(AocHeapItem x, AocHeapItem y, bool max)
+{
+	return max ? heap_item_less(y, x) : heap_item_less(x, y);
+}
+
+static inline void
+heap4_sift_up_(AocHeapItem *a, size_t i, bool max)
+{
+	AocHeapItem it = a[i];
+	while (i > 0U) {
+		size_t p = (i - 1U) >> 2;
+		if (!heap4_before_(it, a[p], max)) {
+			break;
+		}
+		a[i] = a[p];
+		i = p;
+	}
+	a[i] = it;
+}
+
+static inline void
+heap4_sift_down_(AocHeapItem *a, size_t n, size_t i, bool max)
+{
+	AocHeapItem it = a[i];
+	for (;;) {
+		size_t c = (i << 2) + 1U;
+		if (c >= n) {
+			break;
+		}
+		size_t best = c;
+		size_t end = (c + 4U < n) ? c + 4U : n;
+		for (size_t j = c + 1U; j < end; j++) {
+			if (heap4_before_(a[j], a[best], max)) {
+				best = j;
+			}
+		}
+		if (!heap4_before_(a[best], it, max)) {
+			break;
+		}
+		a[i] = a[best];
+		i = best;
+	}
+	a[i] = it;
+}
+
+// 4-ary min-heap.
+typedef struct {
+	AocHeapItem *a;
+	size_t n;
+	size_t cap;
+} AocHeap;
+
+static inline void
+heap_init(AocHeap *h, size_t cap)
+{
+	h->n = 0U;
+	h->cap = (cap > 0U) ? cap : 16U;
+	h->a = (AocHeapItem *)xrealloc(NULL, h->cap * sizeof(AocHeapItem));
+}
+
+static inline void
+heap_free(AocHeap *h)
+{
+	free(h->a);
+	h->a = NULL;
+	h->n = h->cap = 0U;
+}
+
+// Takes ownership of a malloc'd array of n items and heapifies it in O(n).
+static inline void
+heap_build(AocHeap *h, AocHeapItem *items, size_t n)
+{
+	h->a = items;
+	h->n = n;
+	h->cap = n;
+	for (size_t i = (n + 2U) / 4U; i-- > 0U;) {
+		heap4_sift_down_(h->a, n, i, false);
+	}
+}
+
+static inline void
+heap_push(AocHeap *h, u64 key, u64 val)
+{
+	if (h->n == h->cap) {
+		h->cap = (h->cap == 0U) ? 16U : h->cap * 2U;
+		h->a = (AocHeapItem *)xrealloc(h->a,
+		    h->cap * sizeof(AocHeapItem));
+	}
+	h->a[h->n] = (AocHeapItem){key, val};
+	heap4_sift_up_(h->a, h->n++, false);
+}
+
+// Removes the smallest item into *out.  Returns false when empty.
+static inline bool
+heap_pop(AocHeap *h, AocHeapItem *out)
+{
+	if (h->n == 0U) {
+		return false;
+	}
+	*out = h->a[0];
+	h->a[0] = h->a[--h->n];
+	if (h->n > 0U) {
+		heap4_sift_down_(h->a, h->n, 0U, false);
+	}
+	return true;
+}
+
+// Monotone radix heap for integer keys: every pushed key must be >= the key
+// last popped, as in Dijkstra with non-negative weights.  Bucket i holds keys
+// whose highest bit differing from the last popped key is bit i-1, so each
+// item moves at most 64 times over its lifetime.  Items with equal keys pop in
+// no particular order.
+typedef struct {
+	AocHeapItem *a;
+	size_t n;
+	size_t cap;
+} AocRadixBucket;
+
+typedef struct {
+	AocRadixBucket b[65];
+	u64 last;
+	size_t n;
+} AocRadixHeap;
+
+static inline void
+rheap_init(AocRadixHeap *r)
+{
+	memset(r, 0, sizeof *r);
+}
+
+static inline void
+rheap_free(AocRadixHeap *r)
+{
+	for (int i = 0; i < 65; i++) {
+		free(r->b[i].a);
+	}
+	memset(r, 0, sizeof *r);
+}
+
+static inline int
+rheap_bucket_(u64 last, u64 key)
+{
+	return (key == last) ? 0 : 64 - __builtin_clzll(key ^ last);
+}
+
+static inline void
+rheap_bucket_push_(AocRadixBucket *bk, AocHeapItem it)
+{
+	if (bk->n == bk->cap) {
+		bk->cap = (bk->cap == 0U) ? 16U : bk->cap * 2U;
+		bk->a = (AocHeapItem *)xrealloc(bk->a,
+		    bk->cap * sizeof(AocHeapItem));
+	}
+	bk->a[bk->n++] = it;
+}
+
+static inline void
+rheap_push(AocRadixHeap *r, u64 key, u64 val)
+{
+	if (key < r->last) {
+		fprintf(stderr, "radix heap: key %llu below last pop %llu\n",
+		    (unsigned long long)key, (unsigned long long)r->last);
+		exit(EXIT_FAILURE);
+	}
+	rheap_bucket_push_(&r->b[rheap_bucket_(r->last, key)],
+	    (AocHeapItem){key, val});
+	r->n++;
+}
+
+static inline bool
+rheap_pop(AocRadixHeap *r, AocHeapItem *out)
+{
+	if (r->n == 0U) {
+		return false;
+	}
+	if (r->b[0].n == 0U) {
+		int i = 1;
+		while (r->b[i].n == 0U) {
+			i++;
+		}
+
+		// the new minimum becomes last; everything else in bucket i
+		// lands in a lower bucket
+		AocRadixBucket *bk = &r->b[i];
+		u64 m = bk->a[0].key;
+		for (size_t j = 1U; j < bk->n; j++) {
+			if (bk->a[j].key < m) {
+				m = bk->a[j].key;
+			}
+		}
+		r->last = m;
+		for (size_t j = 0U; j < bk->n; j++) {
+			rheap_bucket_push_(&r->b[rheap_bucket_(m, bk->a[j].key)],
+			    bk->a[j]);
+		}
+		bk->n = 0U;
+	}
+	*out = r->b[0].a[--r->b[0].n];
+	r->n--;
+	return true;
+}
+
+// Bounded selection of the k smallest items (by key, then val) from a stream,
+// in O(n log k) time and O(k) space.  Backed by a 4-ary max-heap whose root is
+// the current k-th smallest.
+typedef struct {
+	AocHeapItem *a;
+	size_t n;
+	size_t k;
+} AocTopK;
+
+static inline void
+topk_init(AocTopK *t, size_t k)
+{
+	t->n = 0U;
+	t->k = k;
+	t->a = (AocHeapItem *)xrealloc(NULL,
+	    ((k > 0U) ? k : 1U) * sizeof(AocHeapItem));
+}
+
+static inline void
+topk_free(AocTopK *t)
+{
+	free(t->a);
+	t->a = NULL;
+	t->n = t->k = 0U;
+}
+
+static inline void
+topk_offer(AocTopK *t, u64 key, u64 val)
+{
+	AocHeapItem it = {key, val};
+
+	if (t->n < t->k) {
+		t->a[t->n] = it;
+		heap4_sift_up_(t->a, t->n++, true);
+	} else if (t->k > 0U && heap_item_less(it, t->a[0])) {
+		t->a[0] = it;
+		heap4_sift_down_(t->a, t->n, 0U, true);
+	}
+}
+
+// Sorts the kept items ascending in place and returns them; t->n holds the
+// count.  No further offers are allowed afterwards.
+static inline const AocHeapItem *
+topk_sorted(AocTopK *t)
+{
+	for (size_t m = t->n; m > 1U; m--) {
+		SWAP(t->a[0], t->a[m - 1U]);
+		heap4_sift_down_(t->a, m - 1U, 0U, true);
+	}
+	return t->a;
+}
+
+// Open-addressing u64 -> u64 map for memo tables.  One control byte per slot
+// (empty, or a 7-bit tag from the hash) is kept apart from the slots, and a
+// probe compares a whole group of eight control bytes at once with SWAR
+// arithmetic, so a lookup usually reads one control word and one key.  Groups
+// are probed triangularly.  There is no delete; map_clear empties the table
+// with one memset over the control bytes.
+# define AOC_MAP_EMPTY 0x80U
+# define AOC_MAP_GROUP 8U
+
+typedef struct {
+	u8 *ctrl;   // cap bytes: AOC_MAP_EMPTY or tag (high bit clear)
+	u64 *keys;  // cap slots
+	u64 *vals;  // cap slots
+	size_t cap; // power of two, >= AOC_MAP_GROUP
+	size_t n;
+} AocMap;
+
+static inline u64
+map_hash_(u64 x)
+{
+	// splitmix64 finaliser
+	x ^= x >> 30;
+	x *= 0xBF58476D1CE4E5B9ULL;
+	x ^= x >> 27;
+	x *= 0x94D049BB133111EBULL;
+	x ^= x >> 31;
+	return x;
+}
+
+static inline u64
+map_group_(const AocMap *m, size_t g)
+{
+	u64 w;
+	memcpy(&w, m->ctrl + g * AOC_MAP_GROUP, sizeof w);
+# if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+	w = __builtin_bswap64(w);
+# endif
+	return w;
+}
+
+// High bit of each byte of w that equals tag (may also flag the byte above a
+// true match; callers compare keys anyway).
+static inline u64
+map_match_(u64 w, u8 tag)
+{
+	u64 x = w ^ (0x0101010101010101ULL * tag);
+	return (x - 0x0101010101010101ULL) & ~x & 0x8080808080808080ULL;
+}
+
+static inline void
+map_alloc_(AocMap *m, size_t cap)
+{
+	m->cap = cap;
+	m->n = 0U;
+	m->ctrl = (u8 *)xrealloc(NULL, cap);
+	m->keys = (u64 *)xrealloc(NULL, cap * sizeof(u64));
+	m->vals = (u64 *)xrealloc(NULL, cap * sizeof(u64));
+	memset(m->ctrl, AOC_MAP_EMPTY, cap);
+}
+
+// Sized so that `expect` entries fit without rehashing.
+static inline void
+map_init(AocMap *m, size_t expect)
+{
+	size_t cap = AOC_MAP_GROUP;
+	while (cap * 7U / 8U < expect) {
+		cap <<= 1;
+	}
+	map_alloc_(m, cap);
+}
+
+static inline void
+map_free(AocMap *m)
+{
+	free(m->ctrl);
+	free(m->keys);
+	free(m->vals);
+	memset(m, 0, sizeof *m);
+}
+
+static inline void
+map_clear(AocMap *m)
+{
+	memset(m->ctrl, AOC_MAP_EMPTY, m->cap);
+	m->n = 0U;
+}
+
+// Slot holding key, or the empty slot where it would go (*found = false).
+static inline size_t
+map_find_(const AocMap *m, u64 key, bool *found)
+{
+	u64 h = map_hash_(key);
+	u8 tag = (u8)(h & 0x7FU);
+	size_t gmask = m->cap / AOC_MAP_GROUP - 1U;
+	size_t g = (size_t)(h >> 7) & gmask;
+
+	for (size_t stride = 1U;; stride++) {
+		u64 w = map_group_(m, g);
+		for (u64 hit = map_match_(w, tag); hit != 0U; hit &= hit - 1U) {
+			size_t i = g * AOC_MAP_GROUP +
+			    (size_t)(__builtin_ctzll(hit) >> 3);
+			if (m->ctrl[i] == tag && m->keys[i] == key) {
+				*found = true;
+				return i;
+			}
+		}
+		u64 empty = w & 0x8080808080808080ULL;
+		if (empty != 0U) {
+			*found = false;
+			return g * AOC_MAP_GROUP +
+			    (size_t)(__builtin_ctzll(empty) >> 3);
+		}
+		g = (g + stride) & gmask;
+	}
+}
+
+static inline bool
+map_get(const AocMap *m, u64 key, u64 *out)
+{
+	bool found;
+	size_t i = map_find_(m, key, &found);
+	if (found) {
+		*out = m->vals[i];
+	}
+	return found;
+}
+
+static inline void map_put(AocMap *m, u64 key, u64 val);
+
+static inline void
+map_grow_(AocMap *m)
+{
+	AocMap old = *m;
+	map_alloc_(m, old.cap * 2U);
+	for (size_t i = 0U; i < old.cap; i++) {
+		if (old.ctrl[i] != AOC_MAP_EMPTY) {
+			map_put(m, old.keys[i], old.vals[i]);
+		}
+	}
+	map_free(&old);
+}
+
+// Inserts or overwrites.  Load factor is kept at or below 7/8.
+static inline void
+map_put(AocMap *m, u64 key, u64 val)
+{
+	bool found;
+	size_t i = map_find_(m, key, &found);
+	if (found) {
+		m->vals[i] = val;
+		return;
+	}
+	if ((m->n + 1U) * 8U > m->cap * 7U) {
+		map_grow_(m);
+		i = map_find_(m, key, &found);
+	}
+	m->ctrl[i] = (u8)(map_hash_(key) & 0x7FU);
+	m->keys[i] = key;
+	m->vals[i] = val;
+	m->n++;
+}
+
+// Pulls the first group key will probe into cache ahead of a map_get/put.
+static inline void
+map_prefetch(const AocMap *m, u64 key)
+{
+	size_t gmask = m->cap / AOC_MAP_GROUP - 1U;
+	size_t g = (size_t)(map_hash_(key) >> 7) & gmask;
+	__builtin_prefetch(m->ctrl + g * AOC_MAP_GROUP);
+	__builtin_prefetch(m->keys + g * AOC_MAP_GROUP);
+}
+
+// Even-odd scanline fill for closed rectilinear polygons on a cell grid.
+// Vertices (xs[i], ys[i]) are cell coordinates, consecutive vertices (with
+// wrap-around) must share x or y, and cells on the boundary count as inside.
+// Only vertical edges matter: cell row y is inside wherever the line just
+// above it (y - 1/2) or just below it (y + 1/2) is, and each of those is an
+// even-odd crossing count along the row.  No queue, no visited grid.
+typedef struct {
+	int x;
+	int y0; // y0 < y1
+	int y1;
+} AocVEdge;
+
+typedef struct {
+	AocVEdge *e; // sorted by x
+	int n;
+} AocPolyScan;
+
+static inline int
+poly_vedge_cmp_(const void *lhs, const void *rhs)
+{
+	const AocVEdge *a = (const AocVEdge *)lhs;
+	const AocVEdge *b = (const AocVEdge *)rhs;
+	return (a->x > b->x) - (a->x < b->x);
+}
+
+// Returns false if some edge is neither horizontal nor vertical.
+static inline bool
+poly_scan_init(AocPolyScan *ps, const int *xs, const int *ys, int n)
+{
+	ps->e = (AocVEdge *)xrealloc(NULL,
+	    (size_t)(n > 0 ? n : 1) * sizeof(AocVEdge));
+	ps->n = 0;
+
+	for (int i = 0; i < n; i++) {
+		int j = (i + 1 == n) ? 0 : i + 1;
+		if (xs[i] == xs[j]) {
+			if (ys[i] != ys[j]) {
+				ps->e[ps->n++] = (AocVEdge){xs[i],
+				    MIN(ys[i], ys[j]), MAX(ys[i], ys[j])};
+			}
+		} else if (ys[i] != ys[j]) {
+			free(ps->e);
+			ps->e = NULL;
+			return false;
+		}
+	}
+	qsort(ps->e, (size_t)ps->n, sizeof(AocVEdge), poly_vedge_cmp_);
+	return true;
+}
+
+static inline void
+poly_scan_free(AocPolyScan *ps)
+{
+	free(ps->e);
+	ps->e = NULL;
+	ps->n = 0;
+}
+
+// Writes the inside cells of row y as inclusive [x0, x1] pairs to spans
+// (room for ps->n ints is enough) and returns the number of pairs.
+static inline int
+poly_scan_row(const AocPolyScan *ps, int y, int *spans)
+{
+	bool up = false;
+	bool dn = false;
+	int start = 0;
+	int k = 0;
+
+	for (int i = 0; i < ps->n;) {
+		int x = ps->e[i].x;
+		bool was = up || dn;
+
+		for (; i < ps->n && ps->e[i].x == x; i++) {
+			up ^= ps->e[i].y0 < y && y <= ps->e[i].y1;
+			dn ^= ps->e[i].y0 <= y && y < ps->e[i].y1;
+		}
+
+		bool now = up || dn;
+		if (!was && now) {
+			start = x;
+		} else if (was && !now) {
+			spans[k++] = start;
+			spans[k++] = x;
+		}
+	}
+	return k / 2;
+}
+
+// Row-major w x h bit grid (bit y * w + x) of the cells inside the polygon.
+static inline bool
+poly_fill_bits(AocBits *out, int w, int h, const int *xs, const int *ys,
+    int n)
+{
+	AocPolyScan ps;
+	if (!poly_scan_init(&ps, xs, ys, n)) {
+		return false;
+	}
+	int *spans = (int *)xrealloc(NULL, (size_t)(ps.n + 2) * sizeof(int));
+
+	bits_init(out, w * h);
+	for (int y = 0; y < h; y++) {
+		int ns = poly_scan_row(&ps, y, spans);
+		for (int s = 0; s < ns; s++) {
+			int x0 = MAX(spans[2 * s], 0);
+			int x1 = MIN(spans[2 * s + 1], w - 1);
+			bits_set_range(out, y * w + x0, y * w + x1 + 1);
+		}
+	}
+
+	free(spans);
+	poly_scan_free(&ps);
+	return true;
+}
+
+// Summed-area table over the w x h grid, (h + 1) x (w + 1) entries, row 0 and
+// column 0 zero: sat[y * (w + 1) + x] counts cells in [0, y) x [0, x) whose
+// membership equals `inside`.  Filled in the same pass as the scan.
+static inline bool
+poly_fill_sat(u32 *sat, int w, int h, const int *xs, const int *ys, int n,
+    bool inside)
+{
+	AocPolyScan ps;
+	if (!poly_scan_init(&ps, xs, ys, n)) {
+		return false;
+	}
+	int *spans = (int *)xrealloc(NULL, (size_t)(ps.n + 2) * sizeof(int));
+	size_t stride = (size_t)w + 1U;
+
+	memset(sat, 0, stride * sizeof(u32));
+	for (int y = 0; y < h; y++) {
+		const u32 *above = sat + (size_t)y * stride;
+		u32 *row = sat + (size_t)(y + 1) * stride;
+		int ns = poly_scan_row(&ps, y, spans);
+		int s = 0;
+		u32 run = 0U;
+
+		row[0] = 0U;
+		for (int x = 0; x < w; x++) {
+			while (s < ns && spans[2 * s + 1] < x) {
+				s++;
+			}
+			bool in = s < ns && spans[2 * s] <= x;
+			run += (in == inside) ? 1U : 0U;
+			row[x + 1] = above[x + 1] + run;
+		}
+	}
+
+	free(spans);
+	poly_scan_free(&ps);
+	return true;
+}
+
 #endif /* AOC_H_INCLUDED */
@@ -0,0 +1,652 @@
+#include "aoc.h"
+#include <inttypes.h>
+#include <stdio.h>
+#include <time.h>
+
+// Micro-benchmarks for the aoc.h primitives.  The report is a single JSON
+// document on stdout:
+//
+//   {"suite": "aoc.h", "results": [
+//     {"name": ..., "pattern": ..., "n": ..., "reps": ..., "sec": ...,
+//      "ns_per_item": ..., "check": "<hex>"}, ...]}
+//
+// n is the input size, reps how many times the timed loop ran over it, and
+// ns_per_item = sec / (n * reps).  Each benchmark checksums its output so the
+// compiler cannot drop the work and so variants of the same operation can be
+// compared for agreement.
+static volatile u64 sink;
+static int nresults;
+
+static double
+now_sec(void)
+{
+	struct timespec ts;
+	clock_gettime(CLOCK_MONOTONIC, &ts);
+	return (double)ts.tv_sec + (double)ts.tv_nsec * 1e-9;
+}
+
+static u64 rng_state = 0x9E3779B97F4A7C15ULL;
+
+static u64
+rng_next(void)
+{
+	// splitmix64
+	u64 z = (rng_state += 0x9E3779B97F4A7C15ULL);
+	z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+	z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+	return z ^ (z >> 31);
+}
+
+static int
+cmp_item(const void *lhs, const void *rhs)
+{
+	AocHeapItem a = *(const AocHeapItem *)lhs;
+	AocHeapItem b = *(const AocHeapItem *)rhs;
+	return heap_item_less(b, a) - heap_item_less(a, b);
+}
+
+static void
+report(const char *name, const char *pattern, size_t n, size_t reps,
+    double sec, u64 check)
+{
+	printf("%s\n    {\"name\": \"%s\", \"pattern\": \"%s\", \"n\": %zu, "
+	    "\"reps\": %zu, \"sec\": %.6f, \"ns_per_item\": %.3f, "
+	    "\"check\": \"%016" PRIx64 "\"}",
+	    nresults++ > 0 ? "," : "", name, pattern, n, reps, sec,
+	    sec * 1e9 / ((double)n * (double)reps), check);
+}
+
+// Repeat small inputs so every timed loop touches about 4M items.
+static size_t
+reps_for(size_t n)
+{
+	return n >= 4000000U ? 1U : 4000000U / n;
+}
+
+static AocHeapItem *
+random_items(size_t n, u64 key_mask)
+{
+	AocHeapItem *a = (AocHeapItem *)xrealloc(NULL, n * sizeof *a);
+	for (size_t i = 0; i < n; i++) {
+		a[i].key = rng_next() & key_mask;
+		a[i].val = i;
+	}
+	return a;
+}
+
+static u64
+fold(u64 h, AocHeapItem it)
+{
+	return (h ^ it.key ^ (it.val << 1)) * 0x100000001B3ULL;
+}
+
+// Full sort: 4-ary heap push/pop vs qsort.
+static void
+bench_heap(size_t n)
+{
+	AocHeapItem *src = random_items(n, ~0ULL);
+	AocHeapItem *tmp = (AocHeapItem *)xrealloc(NULL, n * sizeof *tmp);
+	AocHeap h;
+	AocHeapItem it;
+	u64 check;
+	double t0;
+
+	t0 = now_sec();
+	heap_init(&h, n);
+	for (size_t i = 0; i < n; i++) {
+		heap_push(&h, src[i].key, src[i].val);
+	}
+	check = 0U;
+	while (heap_pop(&h, &it)) {
+		check = fold(check, it);
+	}
+	heap_free(&h);
+	report("heap4 push+pop", "random", n, 1, now_sec() - t0, check);
+
+	memcpy(tmp, src, n * sizeof *tmp);
+	t0 = now_sec();
+	heap_build(&h, tmp, n);
+	check = 0U;
+	while (heap_pop(&h, &it)) {
+		check = fold(check, it);
+	}
+	report("heap4 build+pop", "random", n, 1, now_sec() - t0, check);
+	tmp = h.a; // heap_build took ownership; reuse the buffer
+
+	memcpy(tmp, src, n * sizeof *tmp);
+	t0 = now_sec();
+	qsort(tmp, n, sizeof *tmp, cmp_item);
+	check = 0U;
+	for (size_t i = 0; i < n; i++) {
+		check = fold(check, tmp[i]);
+	}
+	report("qsort", "random", n, 1, now_sec() - t0, check);
+
+	free(tmp);
+	free(src);
+	sink += check;
+}
+
+// Monotone keys: radix heap vs 4-ary heap vs qsort.  The radix heap does not
+// order equal keys, so the check only folds keys.
+static void
+bench_radix(size_t n)
+{
+	AocHeapItem *src = random_items(n, 0xFFFFFFFFULL);
+	AocHeapItem *tmp = (AocHeapItem *)xrealloc(NULL, n * sizeof *tmp);
+	AocRadixHeap r;
+	AocHeap h;
+	AocHeapItem it;
+	u64 check;
+	double t0;
+
+	t0 = now_sec();
+	rheap_init(&r);
+	for (size_t i = 0; i < n; i++) {
+		rheap_push(&r, src[i].key, src[i].val);
+	}
+	check = 0U;
+	while (rheap_pop(&r, &it)) {
+		check = fold(check, (AocHeapItem){it.key, 0});
+	}
+	rheap_free(&r);
+	report("radix push+pop", "random_u32", n, 1, now_sec() - t0, check);
+
+	t0 = now_sec();
+	heap_init(&h, n);
+	for (size_t i = 0; i < n; i++) {
+		heap_push(&h, src[i].key, src[i].val);
+	}
+	check = 0U;
+	while (heap_pop(&h, &it)) {
+		check = fold(check, (AocHeapItem){it.key, 0});
+	}
+	heap_free(&h);
+	report("heap4 push+pop", "random_u32", n, 1, now_sec() - t0, check);
+
+	memcpy(tmp, src, n * sizeof *tmp);
+	t0 = now_sec();
+	qsort(tmp, n, sizeof *tmp, cmp_item);
+	check = 0U;
+	for (size_t i = 0; i < n; i++) {
+		check = fold(check, (AocHeapItem){tmp[i].key, 0});
+	}
+	report("qsort", "random_u32", n, 1, now_sec() - t0, check);
+
+	// Dijkstra-shaped: pop one, push a few at key + small weight.
+	t0 = now_sec();
+	rheap_init(&r);
+	rheap_push(&r, 0, 0);
+	size_t pushed = 1U;
+	check = 0U;
+	while (rheap_pop(&r, &it)) {
+		check = fold(check, (AocHeapItem){it.key, 0});
+		for (int k = 0; k < 3 && pushed < n; k++, pushed++) {
+			rheap_push(&r, it.key + (src[pushed].key & 1023U),
+			    pushed);
+		}
+	}
+	rheap_free(&r);
+	report("radix push+pop", "dijkstra", n, 1, now_sec() - t0, check);
+
+	t0 = now_sec();
+	heap_init(&h, 64);
+	heap_push(&h, 0, 0);
+	pushed = 1U;
+	check = 0U;
+	while (heap_pop(&h, &it)) {
+		check = fold(check, (AocHeapItem){it.key, 0});
+		for (int k = 0; k < 3 && pushed < n; k++, pushed++) {
+			heap_push(&h, it.key + (src[pushed].key & 1023U),
+			    pushed);
+		}
+	}
+	heap_free(&h);
+	report("heap4 push+pop", "dijkstra", n, 1, now_sec() - t0, check);
+
+	free(tmp);
+	free(src);
+	sink += check;
+}
+
+// K smallest of n: bounded top-K heap vs qsort of everything.
+static void
+bench_topk(size_t n, size_t k)
+{
+	AocHeapItem *src = random_items(n, ~0ULL);
+	AocHeapItem *tmp = (AocHeapItem *)xrealloc(NULL, n * sizeof *tmp);
+	AocTopK t;
+	u64 check;
+	double t0;
+
+	t0 = now_sec();
+	topk_init(&t, k);
+	for (size_t i = 0; i < n; i++) {
+		topk_offer(&t, src[i].key, src[i].val);
+	}
+	const AocHeapItem *a = topk_sorted(&t);
+	check = 0U;
+	for (size_t i = 0; i < t.n; i++) {
+		check = fold(check, a[i]);
+	}
+	topk_free(&t);
+	report("topk", "random", n, 1, now_sec() - t0, check);
+
+	memcpy(tmp, src, n * sizeof *tmp);
+	t0 = now_sec();
+	qsort(tmp, n, sizeof *tmp, cmp_item);
+	check = 0U;
+	for (size_t i = 0; i < k && i < n; i++) {
+		check = fold(check, tmp[i]);
+	}
+	report("qsort then take k", "random", n, 1, now_sec() - t0, check);
+
+	free(tmp);
+	free(src);
+	sink += check;
+}
+
+// Ternary forms to compare against the XOR-mask MIN/MAX in aoc.h.
+#define TERN_MIN(a, b) ((a) < (b) ? (a) : (b))
+#define TERN_MAX(a, b) ((a) > (b) ? (a) : (b))
+
+// "sorted" pairs cross over once (predictable branches); "random" pairs are
+// a coin flip per element.
+static void
+fill_pairs(int *a, int *b, size_t n, bool sorted)
+{
+	for (size_t i = 0; i < n; i++) {
+		if (sorted) {
+			a[i] = (int)i;
+			b[i] = (int)(n - i);
+		} else {
+			a[i] = (int)(rng_next() >> 34);
+			b[i] = (int)(rng_next() >> 34);
+		}
+	}
+}
+
+static void
+bench_minmax(size_t n)
+{
+	int *a = (int *)xrealloc(NULL, n * sizeof *a);
+	int *b = (int *)xrealloc(NULL, n * sizeof *b);
+	size_t reps = reps_for(n);
+	u64 check;
+	double t0;
+
+	for (int sorted = 1; sorted >= 0; sorted--) {
+		const char *pat = sorted ? "sorted" : "random";
+		fill_pairs(a, b, n, sorted);
+
+#define BENCH_PAIRWISE(label, OP)                                       \
+	do {                                                            \
+		t0 = now_sec();                                         \
+		check = 0U;                                             \
+		for (size_t r = 0; r < reps; r++) {                     \
+			for (size_t i = 0; i < n; i++) {                \
+				check += (u64)OP(a[i], b[i]);           \
+			}                                               \
+			sink += check;                                  \
+		}                                                       \
+		report(label, pat, n, reps, now_sec() - t0, check);     \
+	} while (0)
+
+		BENCH_PAIRWISE("MIN xor-mask", MIN);
+		BENCH_PAIRWISE("MIN ternary", TERN_MIN);
+		BENCH_PAIRWISE("MAX xor-mask", MAX);
+		BENCH_PAIRWISE("MAX ternary", TERN_MAX);
+#undef BENCH_PAIRWISE
+
+		// Running maximum: a loop-carried dependency the compiler
+		// cannot vectorise away.
+		t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			int m = a[0];
+			for (size_t i = 0; i < n; i++) {
+				m = MAX(m, a[i] ^ b[i]);
+			}
+			check += (u64)m;
+		}
+		report("MAX running xor-mask", pat, n, reps, now_sec() - t0,
+		    check);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			int m = a[0];
+			for (size_t i = 0; i < n; i++) {
+				m = TERN_MAX(m, a[i] ^ b[i]);
+			}
+			check += (u64)m;
+		}
+		report("MAX running ternary", pat, n, reps, now_sec() - t0,
+		    check);
+	}
+
+	free(a);
+	free(b);
+	sink += check;
+}
+
+// n newline-terminated lines of digit fields.  Line length is drawn from
+// [minlen, maxlen]; a space follows every fieldlen digits.
+static char *
+make_text(size_t n, int minlen, int maxlen, int fieldlen, size_t *len)
+{
+	size_t cap = n * (size_t)(maxlen + 1) + 1U;
+	char *t = (char *)xrealloc(NULL, cap);
+	size_t k = 0U;
+
+	for (size_t i = 0; i < n; i++) {
+		int ll = minlen + (int)(rng_next() % (u64)(maxlen - minlen + 1));
+		for (int c = 0; c < ll; c++) {
+			t[k++] = (c + 1) % (fieldlen + 1) == 0
+			    ? ' '
+			    : (char)('0' + rng_next() % 10U);
+		}
+		t[k++] = '\n';
+	}
+	t[k] = '\0';
+	*len = k;
+	return t;
+}
+
+static void
+bench_read_line(size_t n)
+{
+	static const struct {
+		const char *pat;
+		int minlen;
+		int maxlen;
+	} shapes[] = {
+		{"short_lines", 1, 16},
+		{"long_lines", 64, 256},
+	};
+	char buf[AOC_MAX_W + 4];
+	size_t reps = MAX(reps_for(n) / 16U, (size_t)1U);
+	u64 check = 0U;
+
+	for (size_t s = 0; s < ARRAY_LEN(shapes); s++) {
+		size_t len;
+		char *text = make_text(n, shapes[s].minlen, shapes[s].maxlen, 8,
+		    &len);
+		FILE *fp = fmemopen(text, len, "r");
+		if (fp == NULL) {
+			perror("fmemopen");
+			exit(EXIT_FAILURE);
+		}
+
+		double t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			rewind(fp);
+			while (read_line(fp, buf, sizeof buf)) {
+				check = check * 31U + strlen(buf);
+			}
+		}
+		report("read_line", shapes[s].pat, n, reps, now_sec() - t0,
+		    check);
+
+		fclose(fp);
+		free(text);
+	}
+	sink += check;
+}
+
+static void
+bench_split_fields(size_t n)
+{
+	static const struct {
+		const char *pat;
+		int fieldlen;
+	} shapes[] = {
+		{"wide_fields", 15},
+		{"narrow_fields", 1},
+	};
+	char *fields[256];
+	size_t reps = MAX(reps_for(n) / 16U, (size_t)1U);
+	u64 check = 0U;
+
+	for (size_t s = 0; s < ARRAY_LEN(shapes); s++) {
+		size_t len;
+		char *text = make_text(n, 48, 80, shapes[s].fieldlen, &len);
+		char *work = (char *)xrealloc(NULL, len + 1U);
+
+		// Lines become NUL-terminated strings; the copy is re-made
+		// every rep because split_fields writes into it.
+		for (size_t i = 0; i < len; i++) {
+			if (text[i] == '\n') {
+				text[i] = '\0';
+			}
+		}
+
+		double t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			memcpy(work, text, len + 1U);
+			for (char *p = work; p < work + len;) {
+				size_t ll = strlen(p);
+				int nf = split_fields(p, fields,
+				    (int)ARRAY_LEN(fields));
+				check = check * 31U + (u64)nf + (u64)fields[0][0];
+				p += ll + 1U;
+			}
+		}
+		report("split_fields", shapes[s].pat, n, reps, now_sec() - t0,
+		    check);
+
+		free(work);
+		free(text);
+	}
+	sink += check;
+}
+
+// h x w maze of '.' with roughly wall_pct percent '#'; corners stay open.
+static char *
+make_maze(int h, int w, int wall_pct, size_t *len)
+{
+	char *t = (char *)xrealloc(NULL, (size_t)h * (size_t)(w + 1) + 1U);
+	size_t k = 0U;
+
+	for (int r = 0; r < h; r++) {
+		for (int c = 0; c < w; c++) {
+			bool wall = (int)(rng_next() % 100U) < wall_pct;
+			if ((r == 0 && c == 0) || (r == h - 1 && c == w - 1)) {
+				wall = false;
+			}
+			t[k++] = wall ? '#' : '.';
+		}
+		t[k++] = '\n';
+	}
+	t[k] = '\0';
+	*len = k;
+	return t;
+}
+
+static bool
+maze_open(char ch)
+{
+	return ch != '#';
+}
+
+static void
+bench_grid(int h, int w)
+{
+	static AocGrid g;
+	static const struct {
+		const char *pat;
+		int wall_pct;
+	} shapes[] = {
+		{"open", 0},
+		{"walls_25pct", 25},
+	};
+	size_t n = (size_t)h * (size_t)w;
+	size_t reps = MAX(reps_for(n) / 4U, (size_t)1U);
+	u64 check = 0U;
+	char pat[64];
+
+	for (size_t s = 0; s < ARRAY_LEN(shapes); s++) {
+		size_t len;
+		char *text = make_maze(h, w, shapes[s].wall_pct, &len);
+		FILE *fp = fmemopen(text, len, "r");
+		if (fp == NULL) {
+			perror("fmemopen");
+			exit(EXIT_FAILURE);
+		}
+		snprintf(pat, sizeof pat, "%dx%d_%s", h, w, shapes[s].pat);
+
+		double t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			rewind(fp);
+			if (!grid_load(&g, fp)) {
+				fprintf(stderr, "grid_load failed\n");
+				exit(EXIT_FAILURE);
+			}
+			check += (u64)g.h * (u64)g.w + (u64)g.cells[h - 1][0];
+		}
+		report("grid_load", pat, n, reps, now_sec() - t0, check);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			check += (u64)(i64)bfs_shortest(&g, 0, 0, h - 1, w - 1,
+			    maze_open);
+		}
+		report("bfs_shortest", pat, n, reps, now_sec() - t0, check);
+
+		fclose(fp);
+		free(text);
+	}
+	sink += check;
+}
+
+static void
+bench_bits(size_t n)
+{
+	static const struct {
+		const char *pat;
+		u64 one_in;
+	} shapes[] = {
+		{"sparse_1pct", 100},
+		{"dense_50pct", 2},
+	};
+	size_t reps = reps_for(n);
+	AocBits a;
+	AocBits b;
+	u64 check = 0U;
+
+	for (size_t s = 0; s < ARRAY_LEN(shapes); s++) {
+		const char *pat = shapes[s].pat;
+		bits_init(&a, (int)n);
+		bits_init(&b, (int)n);
+		for (int i = 0; i < (int)n; i++) {
+			if (rng_next() % shapes[s].one_in == 0U) {
+				bits_set(&a, i);
+			}
+			if (rng_next() % shapes[s].one_in == 0U) {
+				bits_set(&b, i);
+			}
+		}
+
+		double t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			bits_xor(&a, &b);
+			check += bits_popcount(&a);
+		}
+		report("bits xor+popcount", pat, n, reps, now_sec() - t0,
+		    check);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			for (int i = bits_first(&a); i >= 0; i = bits_next(&a, i)) {
+				check += (u64)i;
+			}
+		}
+		report("bits iterate", pat, n, reps, now_sec() - t0, check);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t r = 0; r < reps; r++) {
+			bits_shl_or(&b, (int)(r % 97U) + 1);
+			check += b.w[0];
+		}
+		report("bits shl_or", pat, n, reps, now_sec() - t0, check);
+
+		bits_free(&a);
+		bits_free(&b);
+	}
+	sink += check;
+}
+
+static void
+bench_map(size_t n)
+{
+	u64 *keys = (u64 *)xrealloc(NULL, n * sizeof *keys);
+	u64 check = 0U;
+	u64 v;
+
+	for (int seq = 1; seq >= 0; seq--) {
+		const char *pat = seq ? "sequential" : "random";
+		for (size_t i = 0; i < n; i++) {
+			keys[i] = seq ? (u64)i : rng_next();
+		}
+
+		AocMap m;
+		double t0 = now_sec();
+		map_init(&m, 0);
+		for (size_t i = 0; i < n; i++) {
+			map_put(&m, keys[i], i);
+		}
+		report("map put (grow)", pat, n, 1, now_sec() - t0, m.n);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t i = 0; i < n; i++) {
+			if (map_get(&m, keys[i], &v)) {
+				check += v;
+			}
+		}
+		report("map get hit", pat, n, 1, now_sec() - t0, check);
+
+		t0 = now_sec();
+		check = 0U;
+		for (size_t i = 0; i < n; i++) {
+			check += map_get(&m, ~keys[i], &v);
+		}
+		report("map get miss", pat, n, 1, now_sec() - t0, check);
+
+		map_free(&m);
+	}
+
+	free(keys);
+	sink += check;
+}
+
+int
+main(void)
+{
+	static const size_t sizes[] = {10000, 100000, 1000000};
+	static const int dims[][2] = {{64, 64}, {256, 256}, {256, 4096}};
+
+	printf("{\n  \"suite\": \"aoc.h\",\n  \"results\": [");
+	for (size_t i = 0; i < ARRAY_LEN(sizes); i++) {
+		bench_minmax(sizes[i]);
+		bench_read_line(sizes[i]);
+		bench_split_fields(sizes[i]);
+		bench_bits(sizes[i]);
+		bench_map(sizes[i]);
+		bench_heap(sizes[i]);
+		bench_radix(sizes[i]);
+		bench_topk(sizes[i], 1000);
+	}
+	for (size_t i = 0; i < ARRAY_LEN(dims); i++) {
+		bench_grid(dims[i][0], dims[i][1]);
+	}
+	printf("\n  ]\n}\n");
+	return 0;
+}
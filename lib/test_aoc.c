@@ -91,6 +91,236 @@ test_clamp(void)
 	assert(CLAMP(10, -5, 5) == 5);
 }
 
+static void
+test_bits(void)
+{
+	AocBits a;
+	AocBits b;
+
+	bits_init(&a, 200);
+	bits_init(&b, 200);
+	assert(a.nwords == 4);
+	assert(!bits_any(&a));
+	assert(bits_first(&a) == -1);
+
+	/* set/test across word boundaries */
+	bits_set(&a, 0);
+	bits_set(&a, 63);
+	bits_set(&a, 64);
+	bits_set(&a, 199);
+	assert(bits_test(&a, 63) && bits_test(&a, 64) && !bits_test(&a, 65));
+	assert(bits_popcount(&a) == 4);
+
+	/* iteration */
+	int seen[4];
+	int k = 0;
+	for (int i = bits_first(&a); i >= 0; i = bits_next(&a, i)) {
+		seen[k++] = i;
+	}
+	assert(k == 4);
+	assert(seen[0] == 0 && seen[1] == 63 && seen[2] == 64 &&
+	    seen[3] == 199);
+
+	/* and / or / xor / andnot */
+	bits_set(&b, 64);
+	bits_set(&b, 100);
+	assert(bits_intersects(&a, &b));
+	bits_or(&b, &a);
+	assert(bits_popcount(&b) == 5);
+	bits_andnot(&b, &a);
+	assert(bits_popcount(&b) == 1 && bits_test(&b, 100));
+	assert(!bits_intersects(&a, &b));
+	bits_xor(&b, &a);
+	assert(bits_popcount(&b) == 5);
+	bits_and(&b, &a);
+	assert(bits_popcount(&b) == 4);
+
+	bits_reset(&a, 199);
+	bits_flip(&a, 0);
+	assert(bits_popcount(&a) == 2 && bits_first(&a) == 63);
+
+	/* subset sums of {3, 70, 130} */
+	bits_clear(&a);
+	bits_set(&a, 0);
+	bits_shl_or(&a, 3);
+	bits_shl_or(&a, 70);
+	bits_shl_or(&a, 130);
+	assert(bits_popcount(&a) == 6); /* 200 and 203 fall off the end */
+	assert(bits_test(&a, 3) && bits_test(&a, 70) && bits_test(&a, 73));
+	assert(bits_test(&a, 130) && bits_test(&a, 133));
+
+	/* resize keeps low bits and clears the rest */
+	bits_resize(&a, 70);
+	assert(a.nwords == 2 && bits_popcount(&a) == 2);
+	bits_resize(&a, 300);
+	assert(bits_popcount(&a) == 2 && !bits_test(&a, 73));
+
+	bits_free(&a);
+	bits_free(&b);
+}
+
+static void
+test_heap(void)
+{
+	static const u64 keys[] = {5, 1, 9, 1, 7, 3, 3, 8, 0, 2, 6, 4};
+	const size_t n = ARRAY_LEN(keys);
+	AocHeap h;
+	AocHeapItem it;
+	AocHeapItem prev = {0, 0};
+
+	heap_init(&h, 2);
+	for (size_t i = 0; i < n; i++) {
+		heap_push(&h, keys[i], i);
+	}
+	for (size_t i = 0; i < n; i++) {
+		assert(heap_pop(&h, &it));
+		assert(i == 0 || !heap_item_less(it, prev));
+		prev = it;
+	}
+	assert(!heap_pop(&h, &it));
+	heap_free(&h);
+
+	/* heap_build; ties on key break by val */
+	AocHeapItem *items = malloc(n * sizeof *items);
+	assert(items != NULL);
+	for (size_t i = 0; i < n; i++) {
+		items[i] = (AocHeapItem){keys[i], n - i};
+	}
+	heap_build(&h, items, n);
+	assert(heap_pop(&h, &it) && it.key == 0);
+	assert(heap_pop(&h, &it) && it.key == 1 && it.val == n - 3);
+	assert(heap_pop(&h, &it) && it.key == 1 && it.val == n - 1);
+	heap_free(&h);
+}
+
+static void
+test_radix_heap(void)
+{
+	AocRadixHeap r;
+	AocHeapItem it;
+
+	rheap_init(&r);
+	rheap_push(&r, 10, 0);
+	rheap_push(&r, 3, 1);
+	rheap_push(&r, 1u << 20, 2);
+	assert(rheap_pop(&r, &it) && it.key == 3 && it.val == 1);
+	rheap_push(&r, 4, 3); /* monotone: >= 3 */
+	rheap_push(&r, 3, 4);
+	assert(rheap_pop(&r, &it) && it.key == 3);
+	assert(rheap_pop(&r, &it) && it.key == 4);
+	assert(rheap_pop(&r, &it) && it.key == 10);
+	assert(rheap_pop(&r, &it) && it.key == (1u << 20));
+	assert(!rheap_pop(&r, &it));
+	rheap_free(&r);
+}
+
+static void
+test_topk(void)
+{
+	AocTopK t;
+
+	topk_init(&t, 4);
+	for (u64 i = 0; i < 100; i++) {
+		topk_offer(&t, (i * 37) % 100, i);
+	}
+	const AocHeapItem *a = topk_sorted(&t);
+	assert(t.n == 4);
+	for (u64 i = 0; i < 4; i++) {
+		assert(a[i].key == i);
+	}
+	topk_free(&t);
+
+	/* fewer items than k */
+	topk_init(&t, 8);
+	topk_offer(&t, 5, 0);
+	topk_offer(&t, 2, 1);
+	a = topk_sorted(&t);
+	assert(t.n == 2 && a[0].key == 2 && a[1].key == 5);
+	topk_free(&t);
+}
+
+static void
+test_map(void)
+{
+	AocMap m;
+	u64 v = 0;
+
+	map_init(&m, 0);
+	assert(m.cap == AOC_MAP_GROUP);
+	assert(!map_get(&m, 0, &v));
+
+	map_put(&m, 0, 11);
+	map_put(&m, UINT64_MAX, 22);
+	map_put(&m, 0, 33); /* overwrite */
+	assert(m.n == 2);
+	assert(map_get(&m, 0, &v) && v == 33);
+	assert(map_get(&m, UINT64_MAX, &v) && v == 22);
+
+	/* growth keeps every entry */
+	for (u64 k = 1; k <= 100000; k++) {
+		map_put(&m, k * 0x10000U, k);
+	}
+	assert(m.n == 100002);
+	for (u64 k = 1; k <= 100000; k++) {
+		assert(map_get(&m, k * 0x10000U, &v) && v == k);
+	}
+	assert(!map_get(&m, 0x10000U + 1U, &v));
+
+	size_t cap = m.cap;
+	map_clear(&m);
+	assert(m.n == 0 && m.cap == cap);
+	assert(!map_get(&m, 0, &v) && !map_get(&m, 0x10000U, &v));
+	map_put(&m, 7, 8);
+	assert(map_get(&m, 7, &v) && v == 8);
+
+	map_free(&m);
+}
+
+static void
+test_poly_fill(void)
+{
+	/* U-turn polygon; '#' marks cells inside or on the boundary */
+	static const int xs[] = {7, 11, 11, 9, 9, 2, 2, 7};
+	static const int ys[] = {1, 1, 7, 7, 5, 5, 3, 3};
+	static const char *want[] = {
+		".............",
+		".......#####.",
+		".......#####.",
+		"..##########.",
+		"..##########.",
+		"..##########.",
+		".........###.",
+		".........###.",
+		".............",
+	};
+	const int w = 13;
+	const int h = 9;
+	AocBits in;
+
+	assert(poly_fill_bits(&in, w, h, xs, ys, 8));
+	assert(bits_popcount(&in) == 46);
+	for (int y = 0; y < h; y++) {
+		for (int x = 0; x < w; x++) {
+			assert(bits_test(&in, y * w + x) == (want[y][x] == '#'));
+		}
+	}
+	bits_free(&in);
+
+	/* outside-cell summed-area table agrees with the bit grid */
+	u32 sat[(9 + 1) * (13 + 1)];
+	assert(poly_fill_sat(sat, w, h, xs, ys, 8, false));
+	assert(sat[h * (w + 1) + w] == (u32)(w * h - 46));
+	/* rectangle rows 3..5, cols 2..11 is fully inside */
+	u32 out = sat[6 * 14 + 12] - sat[3 * 14 + 12] - sat[6 * 14 + 2] +
+	    sat[3 * 14 + 2];
+	assert(out == 0);
+
+	/* diagonal edge is rejected */
+	static const int bx[] = {0, 3, 3};
+	static const int by[] = {0, 3, 0};
+	assert(!poly_fill_bits(&in, 4, 4, bx, by, 3));
+}
+
 int
 main(void)
 {
@@ -111,6 +341,24 @@ main(void)
 	test_clamp();
 	printf("  CLAMP           OK\n");
 
+	test_bits();
+	printf("  AocBits         OK\n");
+
+	test_heap();
+	printf("  AocHeap         OK\n");
+
+	test_radix_heap();
+	printf("  AocRadixHeap    OK\n");
+
+	test_topk();
+	printf("  AocTopK         OK\n");
+
+	test_map();
+	printf("  AocMap          OK\n");
+
+	test_poly_fill();
+	printf("  poly_fill       OK\n");
+
 	printf("All tests passed.\n");
 	return 0;
 }
@@ -0,0 +1,56 @@
+// Tests for day01's block kernels, built against the day's own source.
+#define main day01_main
+#include "../day01.c"
+#undef main
+
+#include <assert.h>
+
+// Every dial size with its own kernel, powers of two that go through the
+// generic shift-and-mask kernel (1 and 2^16 are the extremes --modulus
+// allows), and sizes that fall back to division.
+static void
+test_rotate_batch(void)
+{
+    static const uint32_t mods[] = {
+        60, 100, 256, 360,
+        1, 2, 64, 128, 512, 4096, 65536,
+        3, 7, 1000, 65535
+    };
+    enum { N = 5000 };
+    static int32_t delta[N];
+
+    srand(1);
+    for (size_t i = 0U; i < sizeof mods / sizeof mods[0]; i++) {
+        int       pa = START_POS, pb = START_POS;
+        long long a1 = 0, a2 = 0, b1 = 0, b2 = 0;
+
+        dial_select(mods[i]);
+        for (int j = 0; j < N; j++) {
+            // Magnitudes of every bit length, up to 2^31 - 1.
+            int32_t mag = (int32_t)(rand() >> (rand() % 31));
+            char    line[16];
+
+            delta[j] = (rand() & 1) ? -mag : mag;
+            snprintf(line, sizeof line, "%c%" PRId32,
+                     delta[j] < 0 ? 'L' : 'R', mag);
+            process_line(line, &pb, &b1, &b2);
+        }
+        rotate_batch(delta, N, &pa, &a1, &a2);
+
+        assert(pa == pb);
+        assert(a1 == b1);
+        assert(a2 == b2);
+    }
+}
+
+int
+main(void)
+{
+    printf("Running day01 tests...\n");
+
+    test_rotate_batch();
+    printf("  rotate_batch    OK\n");
+
+    printf("All tests passed.\n");
+    return 0;
+}
@@ -0,0 +1,102 @@
+// Tests for day03's pick kernels, built against the day's own source.
+#define main day03_main
+#include "../day03.c"
+#undef main
+
+#include <assert.h>
+
+// A bank of 1..cap digits drawn from the top few values, so equal digits
+// (and ties between picks) are common.  Returns its length.
+static size_t
+make_bank(char *bank, size_t cap)
+{
+	size_t len = 1U + (size_t)rand() % cap;
+	int span = 1 + rand() % 9;
+
+	for (size_t i = 0U; i < len; i++) {
+		bank[i] = (char)('9' - rand() % span);
+	}
+	return len;
+}
+
+static void
+test_joltage_all(void)
+{
+	char bank[200];
+
+	srand(42);
+	for (int n = 0; n < 2000; n++) {
+		size_t len = make_bank(bank, sizeof bank);
+		u64 best[MAX_PICK + 1U];
+
+		joltage_all(bank, len, MAX_PICK, best);
+		for (size_t k = 1U; k <= MAX_PICK; k++) {
+			char digits[MAX_PICK];
+			size_t nd = pick_digits(bank, len, k, digits);
+			u64 want = 0U;
+
+			for (size_t i = 0U; i < nd; i++) {
+				want = want * 10U + (u64)(digits[i] - '0');
+			}
+			assert(best[k] == want);
+		}
+	}
+}
+
+// A MAX_K-row table from scan_banks, on one thread and on several, against
+// per-bank add_joltage sums.
+static void
+test_table(void)
+{
+	static char text[400 * 202];
+	static Dec want[MAX_K + 1U];
+	static Totals got; // Dec tables are too big for the stack
+	size_t at = 0U;
+
+	srand(7);
+	for (int n = 0; n < 400; n++) {
+		size_t len = make_bank(text + at, 200U);
+
+		for (size_t k = 1U; k <= MAX_K; k++) {
+			add_joltage(&want[k], text + at, len, k);
+		}
+		at += len;
+		text[at++] = (n % 3 == 0) ? '\r' : '\n';
+		if (text[at - 1U] == '\r') {
+			text[at++] = '\n';
+		}
+	}
+
+	static const int threads[] = { 1, 3, 16 };
+	for (size_t i = 0U; i < sizeof threads / sizeof threads[0]; i++) {
+		FILE *fp = fmemopen(text, at, "r");
+
+		assert(fp != NULL);
+		got = (Totals){ .k = 12U, .table_k = MAX_K };
+		scan_banks(fp, threads[i], &got);
+		fclose(fp);
+
+		assert(memcmp(&got.part2, &want[12], sizeof want[12]) == 0);
+		for (size_t k = 1U; k <= MAX_K; k++) {
+			assert(memcmp(&got.table[k], &want[k],
+			    sizeof want[k]) == 0);
+		}
+	}
+}
+
+int
+main(void)
+{
+	select_kernels();
+
+	printf("Running day03 tests...\n");
+
+	test_joltage_all();
+	printf("  joltage_all     OK\n");
+
+	test_table();
+	printf("  --table rows    OK\n");
+
+	printf("All tests passed.\n");
+	return 0;
+}
@@ -0,0 +1,132 @@
+// Tests for day04's peel and edit engine, built against the day's own
+// source.
+#define main day04_main
+#include "../day04.c"
+#undef main
+
+#include <assert.h>
+
+// Taller than AocGrid could hold, so a capped loader would show up.
+enum { MAP_H = 1000, MAP_W = 150 };
+
+// A MAP_H x MAP_W map, about 60% rolls, as text so it goes through
+// rolls_load like real input.
+static char *
+map_text(unsigned seed, size_t *len)
+{
+    size_t n    = (size_t)MAP_H * (MAP_W + 1U);
+    char  *text = xrealloc(NULL, n);
+
+    srand(seed);
+    for (size_t i = 0U; i < n; i++) {
+        text[i] = (i % (MAP_W + 1U) == MAP_W) ? '\n'
+                  : (rand() % 10 < 6)        ? '@'
+                                             : '.';
+    }
+    *len = n;
+    return text;
+}
+
+static void
+map_load(RollBits *rb, char *text, size_t len)
+{
+    FILE *fp = fmemopen(text, len, "r");
+
+    assert(fp != NULL);
+    bool loaded = rolls_load(rb, fp);
+    assert(loaded);
+    assert(rb->h == MAP_H && rb->w == MAP_W);
+    fclose(fp);
+}
+
+// Per-round removals add up to Part 2, and the striped peel gives the
+// same Part 2 and rounds as one stripe for several thread counts.
+static void
+test_peel(void)
+{
+    static const int threads[] = { 2, 3, 7, 64, MAX_THREADS };
+    size_t   len;
+    char    *text = map_text(1U, &len);
+    RollBits rb;
+    u32     *want;
+    int      nwant;
+
+    map_load(&rb, text, len);
+    u32 part2 = count_removed(&rb, 1, &want, &nwant);
+    bits_free(&rb.bits);
+
+    u32 sum = 0U;
+    for (int i = 0; i < nwant; i++) {
+        sum += want[i];
+    }
+    assert(part2 > 0U);
+    assert(sum == part2);
+
+    for (size_t t = 0U; t < sizeof threads / sizeof threads[0]; t++) {
+        u32 *got;
+        int  ngot;
+
+        map_load(&rb, text, len);
+        u32 p2 = count_removed(&rb, threads[t], &got, &ngot);
+        assert(p2 == part2);
+        assert(ngot == nwant);
+        assert(memcmp(got, want, (size_t)nwant * sizeof *got) == 0);
+        bits_free(&rb.bits);
+        free(got);
+    }
+
+    free(want);
+    free(text);
+}
+
+// The edit engine, seeded from the map, against a fresh load of the map
+// after edits spread over all its rows.
+static void
+test_edits(void)
+{
+    size_t   len;
+    char    *text = map_text(3U, &len);
+    RollBits rb;
+    RollMap  map;
+
+    map_load(&rb, text, len);
+    rollmap_init(&map, &rb);
+    bits_free(&rb.bits);
+    for (int e = 0; e < 5000; e++) {
+        int  r     = rand() % MAP_H;
+        int  c     = rand() % MAP_W;
+        bool place = rand() & 1;
+
+        text[(size_t)r * (MAP_W + 1U) + (size_t)c] = place ? '@' : '.';
+        if (place) {
+            rollmap_place(&map, r * MAP_W + c);
+        } else {
+            rollmap_remove(&map, r * MAP_W + c);
+        }
+    }
+
+    map_load(&rb, text, len);
+    u32 part1 = count_access(&rb);
+    u32 part2 = count_removed(&rb, 1, NULL, NULL);
+    assert(map.access == part1);
+    assert(map.rolls - map.core_n == part2);
+
+    bits_free(&rb.bits);
+    rollmap_free(&map);
+    free(text);
+}
+
+int
+main(void)
+{
+    printf("Running day04 tests...\n");
+
+    test_peel();
+    printf("  striped peel    OK\n");
+
+    test_edits();
+    printf("  RollMap edits   OK\n");
+
+    printf("All tests passed.\n");
+    return 0;
+}